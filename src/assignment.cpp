@@ -0,0 +1,77 @@
+#include "assignment.h"
+#include <limits>
+
+double AssignmentSolver::solve(const std::vector<double>& cost, int rows, int cols, std::vector<int>& rowToCol)
+{
+	const double inf = std::numeric_limits<double>::infinity();
+
+	// 1-based, row and column 0 are the virtual start of each augmenting path
+	u.assign(rows + 1, 0);
+	v.assign(cols + 1, 0);
+	colToRow.assign(cols + 1, 0);
+	way.assign(cols + 1, 0);
+
+	for (int i = 1; i <= rows; i++)
+	{
+		// grow a shortest augmenting path from row i, Dijkstra-like over the
+		// reduced costs cost - u - v
+		colToRow[0] = i;
+		int col = 0;
+		minSlack.assign(cols + 1, inf);
+		used.assign(cols + 1, 0);
+		do
+		{
+			used[col] = 1;
+			int row = colToRow[col];
+			double delta = inf;
+			int next = 0;
+			for (int j = 1; j <= cols; j++)
+			{
+				if (used[j])
+					continue;
+				double reduced = cost[(row - 1) * cols + (j - 1)] - u[row] - v[j];
+				if (reduced < minSlack[j])
+				{
+					minSlack[j] = reduced;
+					way[j] = col;
+				}
+				if (minSlack[j] < delta)
+				{
+					delta = minSlack[j];
+					next = j;
+				}
+			}
+			for (int j = 0; j <= cols; j++)
+			{
+				if (used[j])
+				{
+					u[colToRow[j]] += delta;
+					v[j] -= delta;
+				}
+				else
+					minSlack[j] -= delta;
+			}
+			col = next;
+		} while (colToRow[col] != 0);
+
+		// flip the path
+		do
+		{
+			int prev = way[col];
+			colToRow[col] = colToRow[prev];
+			col = prev;
+		} while (col != 0);
+	}
+
+	rowToCol.assign(rows, -1);
+	double total = 0;
+	for (int j = 1; j <= cols; j++)
+	{
+		if (colToRow[j] != 0)
+		{
+			rowToCol[colToRow[j] - 1] = j - 1;
+			total += cost[(colToRow[j] - 1) * cols + (j - 1)];
+		}
+	}
+	return total;
+}
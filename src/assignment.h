@@ -0,0 +1,29 @@
+#ifndef ASSIGNMENT_H
+#define ASSIGNMENT_H
+
+#include <vector>
+
+/**
+ * Minimum cost assignment of rows to columns (Hungarian method with
+ * potentials, O(rows^2 cols)).
+ *
+ * Every row is assigned to a distinct column, so rows must not exceed cols;
+ * give a row an explicit "unassigned" column to let it stay unassigned.
+ * Solver buffers are kept between calls, so solving many small problems does
+ * not allocate once the largest has been seen.
+ */
+class AssignmentSolver
+{
+public:
+	// cost is row-major rows x cols and finite, use a large value for pairs
+	// that must not be matched; rowToCol receives the column of every row;
+	// returns the total cost
+	double solve(const std::vector<double>& cost, int rows, int cols, std::vector<int>& rowToCol);
+
+private:
+	std::vector<double> u, v, minSlack;
+	std::vector<int> colToRow, way;
+	std::vector<char> used;
+};
+
+#endif /* ASSIGNMENT_H */
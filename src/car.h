@@ -0,0 +1,211 @@
+/* \author Aaron Brown */
+// Structs describing the simulated cars, shared by
+// the renderer and the headless simulation
+
+#ifndef CAR_H
+#define CAR_H
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include "Eigen/Dense"
+#include "ukf.h"
+
+struct Color
+{
+
+	float r, g, b;
+
+	Color(float setR, float setG, float setB)
+		: r(setR), g(setG), b(setB)
+	{}
+};
+
+struct Vect3
+{
+
+	double x, y, z;
+
+	Vect3(double setX, double setY, double setZ)
+		: x(setX), y(setY), z(setZ)
+	{}
+
+	Vect3 operator+(const Vect3& vec)
+	{
+		Vect3 result(x + vec.x, y + vec.y, z + vec.z);
+		return result;
+	}
+};
+
+struct accuation
+{
+	long long time_us;
+	float acceleration;
+	float steering;
+
+	accuation(long long t, float acc, float s)
+		: time_us(t), acceleration(acc), steering(s)
+	{}
+};
+
+struct Car
+{
+
+	// units in meters
+	Vect3 position, dimensions;
+	Eigen::Quaternionf orientation;
+	std::string name;
+	Color color;
+	float velocity;
+	float angle;
+	float acceleration;
+	float steering;
+	// distance between front of vehicle and center of gravity
+	float Lf;
+
+	UKF ukf;
+
+	//accuation instructions
+	std::vector<accuation> instructions;
+	int accuateIndex;
+
+	double sinNegTheta;
+	double cosNegTheta;
+
+	Car()
+		: position(Vect3(0,0,0)), dimensions(Vect3(0,0,0)), color(Color(0,0,0))
+	{}
+ 
+	Car(Vect3 setPosition, Vect3 setDimensions, Color setColor, float setVelocity, float setAngle, float setLf, std::string setName)
+		: position(setPosition), dimensions(setDimensions), color(setColor), velocity(setVelocity), angle(setAngle), Lf(setLf), name(setName)
+	{
+		orientation = getQuaternion(angle);
+		acceleration = 0;
+		steering = 0;
+		accuateIndex = -1;
+
+		sinNegTheta = sin(-angle);
+		cosNegTheta = cos(-angle);
+	}
+
+	// angle around z axis
+	Eigen::Quaternionf getQuaternion(float theta)
+	{
+		Eigen::Matrix3f rotation_mat;
+  		rotation_mat << 
+  		cos(theta), -sin(theta), 0,
+    	sin(theta),  cos(theta), 0,
+    	0, 			 0, 		 1;
+    	
+		Eigen::Quaternionf q(rotation_mat);
+		return q;
+	}
+
+	void setAcceleration(float setAcc)
+	{
+		acceleration = setAcc;
+	}
+
+	void setSteering(float setSteer)
+	{
+		steering = setSteer;
+	}
+
+	void setInstructions(std::vector<accuation> setIn)
+	{
+		for(accuation a : setIn)
+			instructions.push_back(a);
+	}
+
+	void setUKF(UKF tracker)
+	{
+		ukf = tracker;
+	}
+
+	void move(float dt, int time_us)
+	{
+
+		if(instructions.size() > 0 && accuateIndex < (int)instructions.size()-1)
+		{
+			if(time_us >= instructions[accuateIndex+1].time_us)
+			{
+				setAcceleration(instructions[accuateIndex+1].acceleration);
+				setSteering(instructions[accuateIndex+1].steering);
+				accuateIndex++;
+			}
+		}
+
+		position.x += velocity * cos(angle) * dt;
+		position.y += velocity * sin(angle) * dt;
+		angle += velocity*steering*dt/Lf;
+		orientation = getQuaternion(angle);
+		velocity += acceleration*dt;
+
+		sinNegTheta = sin(-angle);
+		cosNegTheta = cos(-angle);
+	}
+
+	// collision helper function
+	bool inbetween(double point, double center, double range) const
+	{
+		return (center - range <= point) && (center + range >= point);
+	}
+
+	bool checkCollision(Vect3 point) const
+	{
+		// check collision for rotated car
+		double xPrime = ((point.x-position.x) * cosNegTheta - (point.y-position.y) * sinNegTheta)+position.x;
+		double yPrime = ((point.y-position.y) * cosNegTheta + (point.x-position.x) * sinNegTheta)+position.y;
+
+		return (inbetween(xPrime, position.x, dimensions.x / 2) && inbetween(yPrime, position.y, dimensions.y / 2) && inbetween(point.z, position.z + dimensions.z / 3, dimensions.z / 3)) ||
+			(inbetween(xPrime, position.x, dimensions.x / 4) && inbetween(yPrime, position.y, dimensions.y / 2) && inbetween(point.z, position.z + dimensions.z * 5 / 6, dimensions.z / 6));
+
+	}
+
+	// distance t along origin + t*direction, direction of unit length, to the
+	// first point of the car's two boxes, or infinity if the ray misses
+	double intersect(const Vect3& origin, const Vect3& direction) const
+	{
+		// ray in the car frame, rotated like in checkCollision
+		double dx = origin.x - position.x;
+		double dy = origin.y - position.y;
+		Vect3 o(dx * cosNegTheta - dy * sinNegTheta, dy * cosNegTheta + dx * sinNegTheta, origin.z - position.z);
+		Vect3 d(direction.x * cosNegTheta - direction.y * sinNegTheta, direction.y * cosNegTheta + direction.x * sinNegTheta, direction.z);
+
+		double bottom = intersectBox(o, d, Vect3(dimensions.x / 2, dimensions.y / 2, dimensions.z / 3), dimensions.z / 3);
+		double top = intersectBox(o, d, Vect3(dimensions.x / 4, dimensions.y / 2, dimensions.z / 6), dimensions.z * 5 / 6);
+		return std::min(bottom, top);
+	}
+
+	// slab test against the axis aligned box centered at (0, 0, centerZ)
+	static double intersectBox(const Vect3& o, const Vect3& d, const Vect3& half, double centerZ)
+	{
+		const double origin[3] = {o.x, o.y, o.z - centerZ};
+		const double dir[3] = {d.x, d.y, d.z};
+		const double extent[3] = {half.x, half.y, half.z};
+
+		double tNear = -std::numeric_limits<double>::infinity();
+		double tFar = std::numeric_limits<double>::infinity();
+		for(int k = 0; k < 3; k++)
+		{
+			if(dir[k] == 0)
+			{
+				// parallel to the slab, either always inside it or never
+				if(std::fabs(origin[k]) > extent[k])
+					return std::numeric_limits<double>::infinity();
+				continue;
+			}
+			double t1 = (-extent[k] - origin[k]) / dir[k];
+			double t2 = (extent[k] - origin[k]) / dir[k];
+			tNear = std::max(tNear, std::min(t1, t2));
+			tFar = std::min(tFar, std::max(t1, t2));
+		}
+
+		if(tNear > tFar || tFar < 0)
+			return std::numeric_limits<double>::infinity();
+		return std::max(tNear, 0.0);
+	}
+};
+
+#endif /* CAR_H */
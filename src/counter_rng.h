@@ -0,0 +1,84 @@
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <cstdint>
+#include <cmath>
+
+/**
+ * Counter-based random numbers (Widynski's Squares): sample n of a stream
+ * is a pure function of (key, n), so there is no state to share between
+ * threads and any sample can be recomputed out of order.
+ */
+struct CounterRng
+{
+	uint64_t key;
+
+	// distinct (seed, stream) pairs give independent streams
+	explicit CounterRng(uint64_t seed, uint64_t stream = 0)
+		: key(mix(seed * 0x9e3779b97f4a7c15ull + stream) | 1)
+	{}
+
+	uint32_t bits(uint64_t counter) const
+	{
+		uint64_t x, y, z;
+		y = x = counter * key;
+		z = y + key;
+		x = x * x + y; x = (x >> 32) | (x << 32);
+		x = x * x + z; x = (x >> 32) | (x << 32);
+		x = x * x + y; x = (x >> 32) | (x << 32);
+		return (x * x + z) >> 32;
+	}
+
+	// uniform in [0, 1]
+	double uniform(uint64_t counter) const
+	{
+		return bits(counter) * (1.0 / 4294967295.0);
+	}
+
+	// standard normal sample n; samples 2k and 2k+1 are the Box-Muller pair
+	// of uniforms 2k and 2k+1, so this matches gaussians() sample for sample
+	double gaussian(uint64_t n) const
+	{
+		double r, theta;
+		polar(n >> 1, r, theta);
+		return (n & 1) ? r * std::sin(theta) : r * std::cos(theta);
+	}
+
+	// standard normal samples first .. first+count-1, two per pair of uniforms
+	void gaussians(uint64_t first, int count, double* out) const
+	{
+		int i = 0;
+		if((first & 1) && count > 0)
+			out[i++] = gaussian(first);
+		for(; i + 1 < count; i += 2)
+		{
+			double r, theta;
+			polar((first + i) >> 1, r, theta);
+			out[i] = r * std::cos(theta);
+			out[i + 1] = r * std::sin(theta);
+		}
+		if(i < count)
+			out[i] = gaussian(first + i);
+	}
+
+	// splitmix64 finalizer, spreads seed bits over the whole key
+	static uint64_t mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+private:
+	// radius and angle of Box-Muller pair k, the radius uniform is in (0, 1]
+	// so the log stays finite
+	void polar(uint64_t k, double& r, double& theta) const
+	{
+		double u1 = (bits(2 * k) + 1.0) * (1.0 / 4294967296.0);
+		double u2 = bits(2 * k + 1) * (1.0 / 4294967296.0);
+		r = std::sqrt(-2.0 * std::log(u1));
+		theta = 6.283185307179586 * u2;
+	}
+};
+
+#endif /* COUNTER_RNG_H */
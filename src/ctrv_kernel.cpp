@@ -0,0 +1,331 @@
+#include "ctrv_kernel.h"
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#include "ctrv_kernel_simd.h"
+#endif
+
+namespace ctrv {
+
+void PredictSigmaPointsScalar(const double* Xsig_aug, int aug_stride,
+                              double* Xsig_pred, int pred_stride,
+                              int n_sig, double delta_t) {
+
+  for (int i = 0; i < n_sig; ++i) {
+    const double* aug = Xsig_aug + i * aug_stride;
+    double* pred = Xsig_pred + i * pred_stride;
+
+    // extract values for better readability
+    double p_x      = aug[0];
+    double p_y      = aug[1];
+    double v        = aug[2];
+    double yaw      = aug[3];
+    double yawd     = aug[4];
+    double nu_a     = aug[5];
+    double nu_yawdd = aug[6];
+
+    // predicted state values
+    double px_p, py_p;
+
+    // avoid division by zero
+    if (fabs(yawd) > 0.001) {
+        px_p = p_x + v/yawd * (sin(yaw + yawd * delta_t) - sin(yaw));
+        py_p = p_y + v/yawd * (cos(yaw) - cos(yaw + yawd * delta_t));
+    } else {
+        px_p = p_x + (v * delta_t * cos(yaw));
+        py_p = p_y + (v * delta_t * sin(yaw));
+    }
+
+    double v_p = v;
+    double yaw_p = yaw + (yawd * delta_t);
+    double yawd_p = yawd;
+
+    // add noise
+    px_p = px_p + (0.5 * nu_a * delta_t * delta_t * cos(yaw));
+    py_p = py_p + (0.5 * nu_a * delta_t * delta_t * sin(yaw));
+    v_p = v_p + (nu_a * delta_t);
+
+    yaw_p = yaw_p + (0.5 * nu_yawdd * delta_t * delta_t);
+    yawd_p = yawd_p + (nu_yawdd * delta_t);
+
+    // write predicted sigma point into right column
+    pred[0] = px_p;
+    pred[1] = py_p;
+    pred[2] = v_p;
+    pred[3] = yaw_p;
+    pred[4] = yawd_p;
+  }
+}
+
+void PredictMaskedSigmaPointsScalar(const double* Xsig_aug, int aug_stride,
+                                    double* Xsig_pred, int pred_stride,
+                                    const double* turn, const double* accel,
+                                    int n_sig, double delta_t) {
+
+  double dt2 = delta_t * delta_t;
+  for (int i = 0; i < n_sig; ++i) {
+    const double* aug = Xsig_aug + i * aug_stride;
+    double* pred = Xsig_pred + i * pred_stride;
+
+    // extract values for better readability
+    double p_x      = aug[0];
+    double p_y      = aug[1];
+    double v        = aug[2];
+    double yaw      = aug[3];
+    double yawd     = aug[4];
+    double a_state  = aug[5];
+    double nu_long  = aug[6];
+    double nu_yawdd = aug[7];
+
+    double w = turn[i] * yawd;
+    double a = accel[i] * a_state;
+    double yaw_p = yaw + w * delta_t;
+    double v_p = v + a * delta_t;
+
+    // predicted state values
+    double px_p, py_p;
+
+    // avoid division by zero
+    if (fabs(w) > 0.001) {
+        px_p = p_x + (v_p * w * sin(yaw_p) + a * cos(yaw_p) - v * w * sin(yaw) - a * cos(yaw)) / (w * w);
+        py_p = p_y + (-v_p * w * cos(yaw_p) + a * sin(yaw_p) + v * w * cos(yaw) - a * sin(yaw)) / (w * w);
+    } else {
+        px_p = p_x + (v * delta_t + 0.5 * a * dt2) * cos(yaw);
+        py_p = p_y + (v * delta_t + 0.5 * a * dt2) * sin(yaw);
+    }
+
+    // add noise, an acceleration without the mask and a jerk with it
+    double noise_p = accel[i] ? nu_long * dt2 * delta_t / 6 : 0.5 * nu_long * dt2;
+    double noise_v = accel[i] ? 0.5 * nu_long * dt2 : nu_long * delta_t;
+    pred[0] = px_p + noise_p * cos(yaw);
+    pred[1] = py_p + noise_p * sin(yaw);
+    pred[2] = v_p + noise_v;
+    pred[3] = yaw_p + 0.5 * nu_yawdd * dt2;
+    pred[4] = yawd + turn[i] * nu_yawdd * delta_t;
+    pred[5] = a_state + accel[i] * nu_long * delta_t;
+  }
+}
+
+void RadarSigmaPointsScalar(const double* Xsig_pred, int pred_stride,
+                            double* Zsig, int z_stride, int n_sig) {
+
+  for (int i = 0; i < n_sig; ++i) {
+    const double* pred = Xsig_pred + i * pred_stride;
+    double* z = Zsig + i * z_stride;
+
+    // extract values for better readability
+    double p_x = pred[0];
+    double p_y = pred[1];
+    double v   = pred[2];
+    double yaw = pred[3];
+
+    double rho = sqrt(p_x * p_x + p_y * p_y);
+    z[0] = rho;                                           // r
+    z[1] = atan2(p_y, p_x);                               // phi
+    z[2] = (p_x * cos(yaw) + p_y * sin(yaw)) * v / rho;   // r_dot
+  }
+}
+
+void PredictSigmaPointsSoAScalar(const double* const* aug, double* const* pred,
+                                 const double* delta_t, int n) {
+
+  for (int j = 0; j < n; ++j) {
+    double point[7];
+    for (int k = 0; k < 7; ++k) {
+      point[k] = aug[k][j];
+    }
+    double predicted[5];
+    PredictSigmaPointsScalar(point, 7, predicted, 5, 1, delta_t[j]);
+    for (int k = 0; k < 5; ++k) {
+      pred[k][j] = predicted[k];
+    }
+  }
+}
+
+void RadarSigmaPointsSoAScalar(const double* const* pred, double* const* z, int n) {
+
+  for (int j = 0; j < n; ++j) {
+    double point[4];
+    for (int k = 0; k < 4; ++k) {
+      point[k] = pred[k][j];
+    }
+    double measured[3];
+    RadarSigmaPointsScalar(point, 4, measured, 3, 1);
+    for (int k = 0; k < 3; ++k) {
+      z[k][j] = measured[k];
+    }
+  }
+}
+
+#if defined(__SSE2__)
+
+namespace {
+
+// SSE2 is the x86-64 baseline, so this path needs no extra compiler flags
+struct SSE2 {
+  typedef __m128d vd;
+  static const int width = 2;
+
+  static vd load(const double* p) { return _mm_loadu_pd(p); }
+  static void store(double* p, vd a) { _mm_storeu_pd(p, a); }
+  static vd set1(double a) { return _mm_set1_pd(a); }
+  static vd add(vd a, vd b) { return _mm_add_pd(a, b); }
+  static vd sub(vd a, vd b) { return _mm_sub_pd(a, b); }
+  static vd mul(vd a, vd b) { return _mm_mul_pd(a, b); }
+  static vd div(vd a, vd b) { return _mm_div_pd(a, b); }
+  static vd fmadd(vd a, vd b, vd c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+  static vd sqrt(vd a) { return _mm_sqrt_pd(a); }
+  static vd abs(vd a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+  static vd min(vd a, vd b) { return _mm_min_pd(a, b); }
+  static vd max(vd a, vd b) { return _mm_max_pd(a, b); }
+  static vd gt(vd a, vd b) { return _mm_cmpgt_pd(a, b); }
+  static vd select(vd mask, vd a, vd b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+  static vd and_(vd a, vd b) { return _mm_and_pd(a, b); }
+  static vd xor_(vd a, vd b) { return _mm_xor_pd(a, b); }
+
+  // all ones where the given low bit of the integer representation is clear;
+  // SSE2 has no 64-bit compare, so compare the low words and spread them
+  static vd bit_clear_mask(vd a, int bit) {
+    __m128i bits = _mm_and_si128(_mm_castpd_si128(a), _mm_set1_epi64x(1LL << bit));
+    __m128i low = _mm_cmpeq_epi32(bits, _mm_setzero_si128());
+    return _mm_castsi128_pd(_mm_shuffle_epi32(low, _MM_SHUFFLE(2, 2, 0, 0)));
+  }
+
+  // sign bit set where the given bit of the integer representation is set
+  static vd sign_from_bit(vd a, int bit) {
+    __m128i moved = _mm_slli_epi64(_mm_castpd_si128(a), 63 - bit);
+    return _mm_and_pd(_mm_castsi128_pd(moved), _mm_set1_pd(-0.0));
+  }
+};
+
+}  // namespace
+
+void PredictSigmaPointsSSE2(const double* Xsig_aug, int aug_stride,
+                            double* Xsig_pred, int pred_stride,
+                            int n_sig, double delta_t) {
+  simd::PredictSigmaPointsSimd<SSE2>(Xsig_aug, aug_stride, Xsig_pred, pred_stride, n_sig, delta_t);
+}
+
+void PredictMaskedSigmaPointsSSE2(const double* Xsig_aug, int aug_stride,
+                                  double* Xsig_pred, int pred_stride,
+                                  const double* turn, const double* accel,
+                                  int n_sig, double delta_t) {
+  simd::PredictMaskedSigmaPointsSimd<SSE2>(Xsig_aug, aug_stride, Xsig_pred, pred_stride, turn, accel, n_sig, delta_t);
+}
+
+void RadarSigmaPointsSSE2(const double* Xsig_pred, int pred_stride,
+                          double* Zsig, int z_stride, int n_sig) {
+  simd::RadarSigmaPointsSimd<SSE2>(Xsig_pred, pred_stride, Zsig, z_stride, n_sig);
+}
+
+void PredictSigmaPointsSoASSE2(const double* const* aug, double* const* pred,
+                               const double* delta_t, int n) {
+  simd::PredictSigmaPointsSoASimd<SSE2>(aug, pred, delta_t, n);
+}
+
+void RadarSigmaPointsSoASSE2(const double* const* pred, double* const* z, int n) {
+  simd::RadarSigmaPointsSoASimd<SSE2>(pred, z, n);
+}
+
+#endif  // __SSE2__
+
+namespace {
+
+bool HasAVX2() {
+#if defined(UKF_ENABLE_AVX2)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+  return false;
+#endif
+}
+
+PredictSigmaPointsFn SelectKernel() {
+#if defined(UKF_ENABLE_AVX2)
+  if (HasAVX2())
+    return PredictSigmaPointsAVX2;
+#endif
+#if defined(__SSE2__)
+  return PredictSigmaPointsSSE2;
+#else
+  return PredictSigmaPointsScalar;
+#endif
+}
+
+PredictMaskedSigmaPointsFn SelectMaskedKernel() {
+#if defined(UKF_ENABLE_AVX2)
+  if (HasAVX2())
+    return PredictMaskedSigmaPointsAVX2;
+#endif
+#if defined(__SSE2__)
+  return PredictMaskedSigmaPointsSSE2;
+#else
+  return PredictMaskedSigmaPointsScalar;
+#endif
+}
+
+RadarSigmaPointsFn SelectRadarKernel() {
+#if defined(UKF_ENABLE_AVX2)
+  if (HasAVX2())
+    return RadarSigmaPointsAVX2;
+#endif
+#if defined(__SSE2__)
+  return RadarSigmaPointsSSE2;
+#else
+  return RadarSigmaPointsScalar;
+#endif
+}
+
+PredictSigmaPointsSoAFn SelectSoAKernel() {
+#if defined(UKF_ENABLE_AVX2)
+  if (HasAVX2())
+    return PredictSigmaPointsSoAAVX2;
+#endif
+#if defined(__SSE2__)
+  return PredictSigmaPointsSoASSE2;
+#else
+  return PredictSigmaPointsSoAScalar;
+#endif
+}
+
+RadarSigmaPointsSoAFn SelectRadarSoAKernel() {
+#if defined(UKF_ENABLE_AVX2)
+  if (HasAVX2())
+    return RadarSigmaPointsSoAAVX2;
+#endif
+#if defined(__SSE2__)
+  return RadarSigmaPointsSoASSE2;
+#else
+  return RadarSigmaPointsSoAScalar;
+#endif
+}
+
+}  // namespace
+
+PredictSigmaPointsFn PredictSigmaPointsKernel() {
+  static const PredictSigmaPointsFn kernel = SelectKernel();
+  return kernel;
+}
+
+PredictMaskedSigmaPointsFn PredictMaskedSigmaPointsKernel() {
+  static const PredictMaskedSigmaPointsFn kernel = SelectMaskedKernel();
+  return kernel;
+}
+
+RadarSigmaPointsFn RadarSigmaPointsKernel() {
+  static const RadarSigmaPointsFn kernel = SelectRadarKernel();
+  return kernel;
+}
+
+PredictSigmaPointsSoAFn PredictSigmaPointsSoAKernel() {
+  static const PredictSigmaPointsSoAFn kernel = SelectSoAKernel();
+  return kernel;
+}
+
+RadarSigmaPointsSoAFn RadarSigmaPointsSoAKernel() {
+  static const RadarSigmaPointsSoAFn kernel = SelectRadarSoAKernel();
+  return kernel;
+}
+
+}  // namespace ctrv
@@ -0,0 +1,173 @@
+#ifndef CTRV_KERNEL_H
+#define CTRV_KERNEL_H
+
+/**
+ * CTRV sigma point kernels.
+ *
+ * Every kernel reads augmented sigma points [p_x p_y v yaw yawd nu_a nu_yawdd]
+ * stored column-major (one sigma point per column, aug_stride rows) and writes
+ * the predicted [p_x p_y v yaw yawd] into a column-major matrix with
+ * pred_stride rows, which is the layout of the fixed-size Eigen matrices in
+ * UnscentedKalmanFilter. The masked and radar kernels below use the same
+ * layout.
+ */
+namespace ctrv {
+
+typedef void (*PredictSigmaPointsFn)(const double* Xsig_aug, int aug_stride,
+                                     double* Xsig_pred, int pred_stride,
+                                     int n_sig, double delta_t);
+
+// reference implementation, one sigma point at a time
+void PredictSigmaPointsScalar(const double* Xsig_aug, int aug_stride,
+                              double* Xsig_pred, int pred_stride,
+                              int n_sig, double delta_t);
+
+#if defined(__SSE2__)
+// two sigma points per instruction
+void PredictSigmaPointsSSE2(const double* Xsig_aug, int aug_stride,
+                            double* Xsig_pred, int pred_stride,
+                            int n_sig, double delta_t);
+#endif
+
+#if defined(UKF_ENABLE_AVX2)
+// four sigma points per instruction, needs AVX2 and FMA at runtime
+void PredictSigmaPointsAVX2(const double* Xsig_aug, int aug_stride,
+                            double* Xsig_pred, int pred_stride,
+                            int n_sig, double delta_t);
+#endif
+
+/**
+ * Masked CTRA kernels for model banks such as the IMM filter: augmented
+ * sigma points [p_x p_y v yaw yawd a nu_long nu_yawdd] are propagated to
+ * [p_x p_y v yaw yawd a]. turn[i] and accel[i] are 1 or 0 and switch sigma
+ * point i's turn rate and acceleration on or off, so CV (both off), CTRV
+ * (turn only) and CTRA (both) run in one call. nu_long drives the speed of
+ * points without acceleration and the acceleration of points with it.
+ */
+typedef void (*PredictMaskedSigmaPointsFn)(const double* Xsig_aug, int aug_stride,
+                                           double* Xsig_pred, int pred_stride,
+                                           const double* turn, const double* accel,
+                                           int n_sig, double delta_t);
+
+void PredictMaskedSigmaPointsScalar(const double* Xsig_aug, int aug_stride,
+                                    double* Xsig_pred, int pred_stride,
+                                    const double* turn, const double* accel,
+                                    int n_sig, double delta_t);
+
+#if defined(__SSE2__)
+void PredictMaskedSigmaPointsSSE2(const double* Xsig_aug, int aug_stride,
+                                  double* Xsig_pred, int pred_stride,
+                                  const double* turn, const double* accel,
+                                  int n_sig, double delta_t);
+#endif
+
+#if defined(UKF_ENABLE_AVX2)
+void PredictMaskedSigmaPointsAVX2(const double* Xsig_aug, int aug_stride,
+                                  double* Xsig_pred, int pred_stride,
+                                  const double* turn, const double* accel,
+                                  int n_sig, double delta_t);
+#endif
+
+/**
+ * Radar measurement kernels: predicted sigma points [p_x p_y v yaw ...] to
+ * [rho phi rho_dot], written column-major with z_stride rows
+ */
+typedef void (*RadarSigmaPointsFn)(const double* Xsig_pred, int pred_stride,
+                                   double* Zsig, int z_stride, int n_sig);
+
+void RadarSigmaPointsScalar(const double* Xsig_pred, int pred_stride,
+                            double* Zsig, int z_stride, int n_sig);
+
+#if defined(__SSE2__)
+void RadarSigmaPointsSSE2(const double* Xsig_pred, int pred_stride,
+                          double* Zsig, int z_stride, int n_sig);
+#endif
+
+#if defined(UKF_ENABLE_AVX2)
+void RadarSigmaPointsAVX2(const double* Xsig_pred, int pred_stride,
+                          double* Zsig, int z_stride, int n_sig);
+#endif
+
+/**
+ * Structure-of-arrays kernels for filter banks such as UKFBatch: component k
+ * of sigma point j lives at aug[k][j] (pred[k][j], z[k][j]) and every point
+ * has its own time step delta_t[j]. Same models as the kernels above.
+ */
+typedef void (*PredictSigmaPointsSoAFn)(const double* const* aug, double* const* pred,
+                                        const double* delta_t, int n);
+typedef void (*RadarSigmaPointsSoAFn)(const double* const* pred, double* const* z, int n);
+
+void PredictSigmaPointsSoAScalar(const double* const* aug, double* const* pred,
+                                 const double* delta_t, int n);
+void RadarSigmaPointsSoAScalar(const double* const* pred, double* const* z, int n);
+
+#if defined(__SSE2__)
+void PredictSigmaPointsSoASSE2(const double* const* aug, double* const* pred,
+                               const double* delta_t, int n);
+void RadarSigmaPointsSoASSE2(const double* const* pred, double* const* z, int n);
+#endif
+
+#if defined(UKF_ENABLE_AVX2)
+void PredictSigmaPointsSoAAVX2(const double* const* aug, double* const* pred,
+                               const double* delta_t, int n);
+void RadarSigmaPointsSoAAVX2(const double* const* pred, double* const* z, int n);
+#endif
+
+/**
+ * Best kernel for the running CPU, detected on first use
+ */
+PredictSigmaPointsFn PredictSigmaPointsKernel();
+PredictMaskedSigmaPointsFn PredictMaskedSigmaPointsKernel();
+RadarSigmaPointsFn RadarSigmaPointsKernel();
+PredictSigmaPointsSoAFn PredictSigmaPointsSoAKernel();
+RadarSigmaPointsSoAFn RadarSigmaPointsSoAKernel();
+
+/**
+ * Propagates n_sig sigma points over delta_t with the best available kernel
+ */
+inline void PredictSigmaPoints(const double* Xsig_aug, int aug_stride,
+                               double* Xsig_pred, int pred_stride,
+                               int n_sig, double delta_t) {
+  PredictSigmaPointsKernel()(Xsig_aug, aug_stride, Xsig_pred, pred_stride, n_sig, delta_t);
+}
+
+/**
+ * Propagates n_sig masked CTRA sigma points over delta_t with the best
+ * available kernel
+ */
+inline void PredictMaskedSigmaPoints(const double* Xsig_aug, int aug_stride,
+                                     double* Xsig_pred, int pred_stride,
+                                     const double* turn, const double* accel,
+                                     int n_sig, double delta_t) {
+  PredictMaskedSigmaPointsKernel()(Xsig_aug, aug_stride, Xsig_pred, pred_stride, turn, accel, n_sig, delta_t);
+}
+
+/**
+ * Transforms n_sig sigma points into radar measurement space with the best
+ * available kernel
+ */
+inline void RadarSigmaPoints(const double* Xsig_pred, int pred_stride,
+                             double* Zsig, int z_stride, int n_sig) {
+  RadarSigmaPointsKernel()(Xsig_pred, pred_stride, Zsig, z_stride, n_sig);
+}
+
+/**
+ * Propagates n structure-of-arrays sigma points, each over its own
+ * delta_t[j], with the best available kernel
+ */
+inline void PredictSigmaPointsSoA(const double* const* aug, double* const* pred,
+                                  const double* delta_t, int n) {
+  PredictSigmaPointsSoAKernel()(aug, pred, delta_t, n);
+}
+
+/**
+ * Transforms n structure-of-arrays sigma points into radar measurement space
+ * with the best available kernel
+ */
+inline void RadarSigmaPointsSoA(const double* const* pred, double* const* z, int n) {
+  RadarSigmaPointsSoAKernel()(pred, z, n);
+}
+
+}  // namespace ctrv
+
+#endif  // CTRV_KERNEL_H
@@ -0,0 +1,79 @@
+// Built with -mavx2 -mfma; only called after runtime CPU detection in
+// the ctrv::*Kernel() selectors.
+
+#include "ctrv_kernel.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#include "ctrv_kernel_simd.h"
+
+namespace ctrv {
+
+namespace {
+
+struct AVX2 {
+  typedef __m256d vd;
+  static const int width = 4;
+
+  static vd load(const double* p) { return _mm256_loadu_pd(p); }
+  static void store(double* p, vd a) { _mm256_storeu_pd(p, a); }
+  static vd set1(double a) { return _mm256_set1_pd(a); }
+  static vd add(vd a, vd b) { return _mm256_add_pd(a, b); }
+  static vd sub(vd a, vd b) { return _mm256_sub_pd(a, b); }
+  static vd mul(vd a, vd b) { return _mm256_mul_pd(a, b); }
+  static vd div(vd a, vd b) { return _mm256_div_pd(a, b); }
+  static vd fmadd(vd a, vd b, vd c) { return _mm256_fmadd_pd(a, b, c); }
+  static vd sqrt(vd a) { return _mm256_sqrt_pd(a); }
+  static vd abs(vd a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+  static vd min(vd a, vd b) { return _mm256_min_pd(a, b); }
+  static vd max(vd a, vd b) { return _mm256_max_pd(a, b); }
+  static vd gt(vd a, vd b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+  static vd select(vd mask, vd a, vd b) { return _mm256_blendv_pd(b, a, mask); }
+  static vd and_(vd a, vd b) { return _mm256_and_pd(a, b); }
+  static vd xor_(vd a, vd b) { return _mm256_xor_pd(a, b); }
+
+  // all ones where the given low bit of the integer representation is clear
+  static vd bit_clear_mask(vd a, int bit) {
+    __m256i bits = _mm256_and_si256(_mm256_castpd_si256(a), _mm256_set1_epi64x(1LL << bit));
+    return _mm256_castsi256_pd(_mm256_cmpeq_epi64(bits, _mm256_setzero_si256()));
+  }
+
+  // sign bit set where the given bit of the integer representation is set
+  static vd sign_from_bit(vd a, int bit) {
+    __m256i moved = _mm256_slli_epi64(_mm256_castpd_si256(a), 63 - bit);
+    return _mm256_and_pd(_mm256_castsi256_pd(moved), _mm256_set1_pd(-0.0));
+  }
+};
+
+}  // namespace
+
+void PredictSigmaPointsAVX2(const double* Xsig_aug, int aug_stride,
+                            double* Xsig_pred, int pred_stride,
+                            int n_sig, double delta_t) {
+  simd::PredictSigmaPointsSimd<AVX2>(Xsig_aug, aug_stride, Xsig_pred, pred_stride, n_sig, delta_t);
+}
+
+void PredictMaskedSigmaPointsAVX2(const double* Xsig_aug, int aug_stride,
+                                  double* Xsig_pred, int pred_stride,
+                                  const double* turn, const double* accel,
+                                  int n_sig, double delta_t) {
+  simd::PredictMaskedSigmaPointsSimd<AVX2>(Xsig_aug, aug_stride, Xsig_pred, pred_stride, turn, accel, n_sig, delta_t);
+}
+
+void RadarSigmaPointsAVX2(const double* Xsig_pred, int pred_stride,
+                          double* Zsig, int z_stride, int n_sig) {
+  simd::RadarSigmaPointsSimd<AVX2>(Xsig_pred, pred_stride, Zsig, z_stride, n_sig);
+}
+
+void PredictSigmaPointsSoAAVX2(const double* const* aug, double* const* pred,
+                               const double* delta_t, int n) {
+  simd::PredictSigmaPointsSoASimd<AVX2>(aug, pred, delta_t, n);
+}
+
+void RadarSigmaPointsSoAAVX2(const double* const* pred, double* const* z, int n) {
+  simd::RadarSigmaPointsSoASimd<AVX2>(pred, z, n);
+}
+
+}  // namespace ctrv
+
+#endif  // __AVX2__ && __FMA__
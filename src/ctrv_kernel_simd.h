@@ -0,0 +1,443 @@
+#ifndef CTRV_KERNEL_SIMD_H
+#define CTRV_KERNEL_SIMD_H
+
+// Width independent body of the vectorized CTRV and masked CTRA kernels.
+// Each translation unit that includes this provides an ISA traits type V with:
+//   vd, width, load, store, set1, add, sub, mul, div, fmadd, sqrt, abs,
+//   min, max, gt, select, and_, xor_, bit_clear_mask, sign_from_bit
+// and instantiates the kernels for V. Everything here is a template
+// on V so instantiations built with different compiler flags never collide.
+
+#include <algorithm>
+#include <cmath>
+
+namespace ctrv {
+namespace simd {
+
+/**
+ * sin and cos of every lane: reduction to [-pi/4, pi/4] around the nearest
+ * multiple of pi/2 (three part Cody-Waite), minimax polynomials from Cephes,
+ * then the quadrant picks and signs both results without branching.
+ * Accurate to a few ulp for |x| well below 1e5.
+ */
+template <class V>
+inline void sincos(typename V::vd x, typename V::vd* s, typename V::vd* c) {
+  typedef typename V::vd vd;
+
+  // round x * 2/pi to the nearest integer q; the integer also sits in the
+  // low mantissa bits of t, which is where the quadrant is read from
+  const double magic = 6755399441055744.0;  // 1.5 * 2^52
+  vd t = V::fmadd(x, V::set1(0.63661977236758134308), V::set1(magic));
+  vd q = V::sub(t, V::set1(magic));
+
+  vd r = V::fmadd(q, V::set1(-1.57079625129699707031e+00), x);
+  r = V::fmadd(q, V::set1(-7.54978941586159635335e-08), r);
+  r = V::fmadd(q, V::set1(-5.39030285815811905290e-15), r);
+  vd z = V::mul(r, r);
+
+  vd ps = V::set1(1.58962301576546568060e-10);
+  ps = V::fmadd(ps, z, V::set1(-2.50507477628578072866e-08));
+  ps = V::fmadd(ps, z, V::set1(2.75573136213857245213e-06));
+  ps = V::fmadd(ps, z, V::set1(-1.98412698295895385996e-04));
+  ps = V::fmadd(ps, z, V::set1(8.33333333332211858878e-03));
+  ps = V::fmadd(ps, z, V::set1(-1.66666666666666307295e-01));
+  ps = V::fmadd(V::mul(ps, z), r, r);
+
+  vd pc = V::set1(-1.13585365213876817300e-11);
+  pc = V::fmadd(pc, z, V::set1(2.08757008419747316778e-09));
+  pc = V::fmadd(pc, z, V::set1(-2.75573141792967388112e-07));
+  pc = V::fmadd(pc, z, V::set1(2.48015872888517045348e-05));
+  pc = V::fmadd(pc, z, V::set1(-1.38888888888730564116e-03));
+  pc = V::fmadd(pc, z, V::set1(4.16666666666665929218e-02));
+  pc = V::fmadd(V::mul(pc, z), z, V::fmadd(z, V::set1(-0.5), V::set1(1.0)));
+
+  // odd quadrants swap sin and cos, quadrants 2,3 negate sin, 1,2 negate cos
+  vd even = V::bit_clear_mask(t, 0);
+  *s = V::xor_(V::select(even, ps, pc), V::sign_from_bit(t, 1));
+  *c = V::xor_(V::select(even, pc, ps), V::sign_from_bit(V::add(t, V::set1(1.0)), 1));
+}
+
+/**
+ * atan2 of every lane: the ratio of the smaller to the larger magnitude is
+ * in [0, 1], above 0.66 it is reduced around pi/4, then the Cephes rational
+ * approximation and the octant and sign fix-ups. atan2(0, 0) is 0.
+ */
+template <class V>
+inline typename V::vd atan2(typename V::vd y, typename V::vd x) {
+  typedef typename V::vd vd;
+
+  const vd zero = V::set1(0.0);
+  const vd one = V::set1(1.0);
+  vd ax = V::abs(x);
+  vd ay = V::abs(y);
+  vd big = V::max(ax, ay);
+  vd t = V::div(V::min(ax, ay), V::select(V::gt(big, zero), big, one));
+
+  vd reduce = V::gt(t, V::set1(0.66));
+  vd r = V::select(reduce, V::div(V::sub(t, one), V::add(t, one)), t);
+  // pi/4 plus the low bits Cephes adds back
+  vd offset = V::select(reduce, V::set1(M_PI / 4 + 0.5 * 6.123233995736765886130e-17), zero);
+
+  vd z = V::mul(r, r);
+  vd p = V::set1(-8.750608600031904122785e-01);
+  p = V::fmadd(p, z, V::set1(-1.615753718733365076637e+01));
+  p = V::fmadd(p, z, V::set1(-7.500855792314704667340e+01));
+  p = V::fmadd(p, z, V::set1(-1.228866684490136173410e+02));
+  p = V::fmadd(p, z, V::set1(-6.485021904942025371773e+01));
+  vd q = V::add(z, V::set1(2.485846490142306297962e+01));
+  q = V::fmadd(q, z, V::set1(1.650270098316988542046e+02));
+  q = V::fmadd(q, z, V::set1(4.328810604912902668951e+02));
+  q = V::fmadd(q, z, V::set1(4.853903996359136964868e+02));
+  q = V::fmadd(q, z, V::set1(1.945506571482613964425e+02));
+  vd a = V::add(offset, V::fmadd(V::mul(r, z), V::div(p, q), r));
+
+  // back from the first octant: swap about pi/4, mirror for negative x,
+  // then the sign of y
+  a = V::select(V::gt(ay, ax), V::sub(V::set1(M_PI / 2), a), a);
+  a = V::select(V::gt(zero, x), V::sub(V::set1(M_PI), a), a);
+  return V::xor_(a, V::and_(y, V::set1(-0.0)));
+}
+
+/**
+ * CTRV process model on one vector of sigma points, in[] holds
+ * [p_x p_y v yaw yawd nu_a nu_yawdd] and out[] gets [p_x p_y v yaw yawd]
+ */
+template <class V>
+inline void PredictCtrv(const typename V::vd in[7], typename V::vd dt,
+                        typename V::vd half_dt2, typename V::vd out[5]) {
+  typedef typename V::vd vd;
+
+  vd p_x      = in[0];
+  vd p_y      = in[1];
+  vd v        = in[2];
+  vd yaw      = in[3];
+  vd yawd     = in[4];
+  vd nu_a     = in[5];
+  vd nu_yawdd = in[6];
+
+  vd yaw_p = V::fmadd(yawd, dt, yaw);
+
+  vd sin_yaw, cos_yaw, sin_yaw_p, cos_yaw_p;
+  sincos<V>(yaw, &sin_yaw, &cos_yaw);
+  sincos<V>(yaw_p, &sin_yaw_p, &cos_yaw_p);
+
+  // avoid division by zero: evaluate both models and blend
+  vd turning = V::gt(V::abs(yawd), V::set1(0.001));
+  vd v_yawd = V::div(v, V::select(turning, yawd, V::set1(1.0)));
+  vd v_dt = V::mul(v, dt);
+
+  vd px_p = V::select(turning,
+                      V::fmadd(v_yawd, V::sub(sin_yaw_p, sin_yaw), p_x),
+                      V::fmadd(v_dt, cos_yaw, p_x));
+  vd py_p = V::select(turning,
+                      V::fmadd(v_yawd, V::sub(cos_yaw, cos_yaw_p), p_y),
+                      V::fmadd(v_dt, sin_yaw, p_y));
+
+  // add noise
+  vd a_dt2 = V::mul(nu_a, half_dt2);
+  out[0] = V::fmadd(a_dt2, cos_yaw, px_p);
+  out[1] = V::fmadd(a_dt2, sin_yaw, py_p);
+  out[2] = V::fmadd(nu_a, dt, v);
+  out[3] = V::fmadd(nu_yawdd, half_dt2, yaw_p);
+  out[4] = V::fmadd(nu_yawdd, dt, yawd);
+}
+
+/**
+ * Radar measurement model on one vector of sigma points, in[] holds
+ * [p_x p_y v yaw] and out[] gets [rho phi rho_dot]
+ */
+template <class V>
+inline void RadarMeasurement(const typename V::vd in[4], typename V::vd out[3]) {
+  typedef typename V::vd vd;
+
+  vd p_x = in[0];
+  vd p_y = in[1];
+  vd v   = in[2];
+  vd yaw = in[3];
+
+  vd sin_yaw, cos_yaw;
+  sincos<V>(yaw, &sin_yaw, &cos_yaw);
+
+  vd rho = V::sqrt(V::fmadd(p_x, p_x, V::mul(p_y, p_y)));
+  vd v_r = V::fmadd(p_x, cos_yaw, V::mul(p_y, sin_yaw));
+  out[0] = rho;
+  out[1] = atan2<V>(p_y, p_x);
+  out[2] = V::div(V::mul(v_r, v), rho);
+}
+
+/**
+ * CTRV process model on V::width sigma points at a time. Sigma points are
+ * transposed block-wise into lane-major scratch so every load is contiguous;
+ * padding lanes are zero and use the straight line model.
+ */
+template <class V>
+void PredictSigmaPointsSimd(const double* Xsig_aug, int aug_stride,
+                            double* Xsig_pred, int pred_stride,
+                            int n_sig, double delta_t) {
+  typedef typename V::vd vd;
+
+  const int kBlock = 16;
+  alignas(32) double in[7][kBlock];
+  alignas(32) double out[5][kBlock];
+
+  const vd dt = V::set1(delta_t);
+  const vd half_dt2 = V::set1(0.5 * delta_t * delta_t);
+
+  for (int start = 0; start < n_sig; start += kBlock) {
+    const int count = std::min(kBlock, n_sig - start);
+
+    for (int j = 0; j < kBlock; ++j) {
+      for (int k = 0; k < 7; ++k) {
+        in[k][j] = j < count ? Xsig_aug[(start + j) * aug_stride + k] : 0.0;
+      }
+    }
+
+    for (int j = 0; j < count; j += V::width) {
+      vd aug[7], pred[5];
+      for (int k = 0; k < 7; ++k) {
+        aug[k] = V::load(&in[k][j]);
+      }
+      PredictCtrv<V>(aug, dt, half_dt2, pred);
+      for (int k = 0; k < 5; ++k) {
+        V::store(&out[k][j], pred[k]);
+      }
+    }
+
+    for (int j = 0; j < count; ++j) {
+      for (int k = 0; k < 5; ++k) {
+        Xsig_pred[(start + j) * pred_stride + k] = out[k][j];
+      }
+    }
+  }
+}
+
+/**
+ * CTRV process model on structure-of-arrays sigma points, component k of
+ * point j at aug[k][j], with a time step per point. The last partial
+ * vector goes through zero padded scratch.
+ */
+template <class V>
+void PredictSigmaPointsSoASimd(const double* const* aug, double* const* pred,
+                               const double* delta_t, int n) {
+  typedef typename V::vd vd;
+
+  alignas(32) double pad_in[8][V::width];
+  alignas(32) double pad_out[5][V::width];
+
+  for (int j = 0; j < n; j += V::width) {
+    const int count = n - j < V::width ? n - j : V::width;
+    vd in[7], out[5], dt;
+    if (count == V::width) {
+      for (int k = 0; k < 7; ++k) {
+        in[k] = V::load(aug[k] + j);
+      }
+      dt = V::load(delta_t + j);
+    } else {
+      for (int l = 0; l < V::width; ++l) {
+        for (int k = 0; k < 7; ++k) {
+          pad_in[k][l] = l < count ? aug[k][j + l] : 0.0;
+        }
+        pad_in[7][l] = l < count ? delta_t[j + l] : 0.0;
+      }
+      for (int k = 0; k < 7; ++k) {
+        in[k] = V::load(pad_in[k]);
+      }
+      dt = V::load(pad_in[7]);
+    }
+
+    PredictCtrv<V>(in, dt, V::mul(V::set1(0.5), V::mul(dt, dt)), out);
+
+    if (count == V::width) {
+      for (int k = 0; k < 5; ++k) {
+        V::store(pred[k] + j, out[k]);
+      }
+    } else {
+      for (int k = 0; k < 5; ++k) {
+        V::store(pad_out[k], out[k]);
+        for (int l = 0; l < count; ++l) {
+          pred[k][j + l] = pad_out[k][l];
+        }
+      }
+    }
+  }
+}
+
+/**
+ * CTRA process model with per sigma point turn and acceleration masks, the
+ * IMM bank's CV, CTRV and CTRA models in one pass. Same blocking as the
+ * CTRV kernel; padding lanes are zero and use the straight line model.
+ */
+template <class V>
+void PredictMaskedSigmaPointsSimd(const double* Xsig_aug, int aug_stride,
+                                  double* Xsig_pred, int pred_stride,
+                                  const double* turn, const double* accel,
+                                  int n_sig, double delta_t) {
+  typedef typename V::vd vd;
+
+  const int kBlock = 16;
+  alignas(32) double in[10][kBlock];
+  alignas(32) double out[6][kBlock];
+
+  const vd dt = V::set1(delta_t);
+  const vd half_dt2 = V::set1(0.5 * delta_t * delta_t);
+  // longitudinal noise weights on position and speed, acceleration for
+  // unmasked and jerk for masked sigma points
+  const vd noise_p_acc = half_dt2;
+  const vd noise_p_jerk = V::set1(delta_t * delta_t * delta_t / 6);
+  const vd one = V::set1(1.0);
+  const vd min_yawd = V::set1(0.001);
+
+  for (int start = 0; start < n_sig; start += kBlock) {
+    const int count = std::min(kBlock, n_sig - start);
+
+    for (int j = 0; j < kBlock; ++j) {
+      for (int k = 0; k < 8; ++k) {
+        in[k][j] = j < count ? Xsig_aug[(start + j) * aug_stride + k] : 0.0;
+      }
+      in[8][j] = j < count ? turn[start + j] : 0.0;
+      in[9][j] = j < count ? accel[start + j] : 0.0;
+    }
+
+    for (int j = 0; j < count; j += V::width) {
+      vd p_x      = V::load(&in[0][j]);
+      vd p_y      = V::load(&in[1][j]);
+      vd v        = V::load(&in[2][j]);
+      vd yaw      = V::load(&in[3][j]);
+      vd yawd     = V::load(&in[4][j]);
+      vd a_state  = V::load(&in[5][j]);
+      vd nu_long  = V::load(&in[6][j]);
+      vd nu_yawdd = V::load(&in[7][j]);
+      vd turn_m   = V::load(&in[8][j]);
+      vd accel_m  = V::load(&in[9][j]);
+
+      vd w = V::mul(yawd, turn_m);
+      vd a = V::mul(a_state, accel_m);
+      vd yaw_p = V::fmadd(w, dt, yaw);
+      vd v_p = V::fmadd(a, dt, v);
+
+      vd sin_yaw, cos_yaw, sin_yaw_p, cos_yaw_p;
+      sincos<V>(yaw, &sin_yaw, &cos_yaw);
+      sincos<V>(yaw_p, &sin_yaw_p, &cos_yaw_p);
+
+      // closed form turn, or the straight line for small turn rates
+      vd turning = V::gt(V::abs(w), min_yawd);
+      vd w_s = V::select(turning, w, one);
+      vd inv_w2 = V::div(one, V::mul(w_s, w_s));
+      vd vw = V::mul(v, w_s);
+      vd vw_p = V::mul(v_p, w_s);
+      vd dx_turn = V::mul(V::sub(V::fmadd(vw_p, sin_yaw_p, V::mul(a, cos_yaw_p)),
+                                 V::fmadd(vw, sin_yaw, V::mul(a, cos_yaw))), inv_w2);
+      vd dy_turn = V::mul(V::sub(V::fmadd(vw, cos_yaw, V::mul(a, sin_yaw_p)),
+                                 V::fmadd(vw_p, cos_yaw_p, V::mul(a, sin_yaw))), inv_w2);
+      vd straight = V::fmadd(a, half_dt2, V::mul(v, dt));
+      vd dx = V::select(turning, dx_turn, V::mul(straight, cos_yaw));
+      vd dy = V::select(turning, dy_turn, V::mul(straight, sin_yaw));
+
+      // add noise
+      vd noise_p = V::mul(nu_long, V::fmadd(accel_m, V::sub(noise_p_jerk, noise_p_acc), noise_p_acc));
+      vd noise_v = V::mul(nu_long, V::fmadd(accel_m, V::sub(half_dt2, dt), dt));
+      V::store(&out[0][j], V::fmadd(noise_p, cos_yaw, V::add(p_x, dx)));
+      V::store(&out[1][j], V::fmadd(noise_p, sin_yaw, V::add(p_y, dy)));
+      V::store(&out[2][j], V::add(v_p, noise_v));
+      V::store(&out[3][j], V::fmadd(nu_yawdd, half_dt2, yaw_p));
+      V::store(&out[4][j], V::fmadd(V::mul(turn_m, nu_yawdd), dt, yawd));
+      V::store(&out[5][j], V::fmadd(V::mul(accel_m, nu_long), dt, a_state));
+    }
+
+    for (int j = 0; j < count; ++j) {
+      for (int k = 0; k < 6; ++k) {
+        Xsig_pred[(start + j) * pred_stride + k] = out[k][j];
+      }
+    }
+  }
+}
+
+/**
+ * Radar measurement model [rho phi rho_dot] of predicted sigma points
+ * [p_x p_y v yaw ...], blocked like the process kernels.
+ */
+template <class V>
+void RadarSigmaPointsSimd(const double* Xsig_pred, int pred_stride,
+                          double* Zsig, int z_stride, int n_sig) {
+  typedef typename V::vd vd;
+
+  const int kBlock = 16;
+  alignas(32) double in[4][kBlock];
+  alignas(32) double out[3][kBlock];
+
+  for (int start = 0; start < n_sig; start += kBlock) {
+    const int count = std::min(kBlock, n_sig - start);
+
+    for (int j = 0; j < kBlock; ++j) {
+      for (int k = 0; k < 4; ++k) {
+        in[k][j] = j < count ? Xsig_pred[(start + j) * pred_stride + k] : 0.0;
+      }
+    }
+
+    for (int j = 0; j < count; j += V::width) {
+      vd pred[4], z[3];
+      for (int k = 0; k < 4; ++k) {
+        pred[k] = V::load(&in[k][j]);
+      }
+      RadarMeasurement<V>(pred, z);
+      for (int k = 0; k < 3; ++k) {
+        V::store(&out[k][j], z[k]);
+      }
+    }
+
+    for (int j = 0; j < count; ++j) {
+      for (int k = 0; k < 3; ++k) {
+        Zsig[(start + j) * z_stride + k] = out[k][j];
+      }
+    }
+  }
+}
+
+/**
+ * Radar measurement model on structure-of-arrays sigma points, like
+ * PredictSigmaPointsSoASimd
+ */
+template <class V>
+void RadarSigmaPointsSoASimd(const double* const* pred, double* const* z, int n) {
+  typedef typename V::vd vd;
+
+  alignas(32) double pad_in[4][V::width];
+  alignas(32) double pad_out[3][V::width];
+
+  for (int j = 0; j < n; j += V::width) {
+    const int count = n - j < V::width ? n - j : V::width;
+    vd in[4], out[3];
+    if (count == V::width) {
+      for (int k = 0; k < 4; ++k) {
+        in[k] = V::load(pred[k] + j);
+      }
+    } else {
+      for (int k = 0; k < 4; ++k) {
+        for (int l = 0; l < V::width; ++l) {
+          pad_in[k][l] = l < count ? pred[k][j + l] : 0.0;
+        }
+        in[k] = V::load(pad_in[k]);
+      }
+    }
+
+    RadarMeasurement<V>(in, out);
+
+    if (count == V::width) {
+      for (int k = 0; k < 3; ++k) {
+        V::store(z[k] + j, out[k]);
+      }
+    } else {
+      for (int k = 0; k < 3; ++k) {
+        V::store(pad_out[k], out[k]);
+        for (int l = 0; l < count; ++l) {
+          z[k][j + l] = pad_out[k][l];
+        }
+      }
+    }
+  }
+}
+
+}  // namespace simd
+}  // namespace ctrv
+
+#endif  // CTRV_KERNEL_SIMD_H
@@ -0,0 +1,243 @@
+/* \author Aaron Brown */
+// Handle logic for creating traffic on highway and animating it
+
+#include "highway_sim.h"
+
+HighwaySim::HighwaySim(bool sqrtUkf)
+	: use_sqrt_ukf(sqrtUkf)
+{
+	if(log_metrics)
+		metrics.reset(new MetricsSink(metricsFile));
+	if(trackingThreads != 1)
+	{
+		scheduler.reset(new TrackingScheduler(trackingThreads));
+		sensors.scheduler = scheduler.get();
+	}
+	sensors.accuracy = RmseAccumulator(rmseWindow, keep_history);
+	setNoiseSeed(noiseSeed);
+
+	egoCar = Car(Vect3(0, 0, 0), Vect3(4, 2, 2), Color(0, 1, 0), 0, 0, 2, "egoCar");
+	
+	Car car1(Vect3(-10, 4, 0), Vect3(4, 2, 2), Color(0, 0, 1), 5, 0, 2, "car1");
+	
+	std::vector<accuation> car1_instructions;
+	accuation a = accuation(0.5*1e6, 0.5, 0.0);
+	car1_instructions.push_back(a);
+	a = accuation(2.2*1e6, 0.0, -0.2);
+	car1_instructions.push_back(a);
+	a = accuation(3.3*1e6, 0.0, 0.2);
+	car1_instructions.push_back(a);
+	a = accuation(4.4*1e6, -2.0, 0.0);
+	car1_instructions.push_back(a);
+
+	car1.setInstructions(car1_instructions);
+	if( trackCars[0] )
+	{
+		UKF ukf1;
+		ukf1.use_sqrt_ = use_sqrt_ukf;
+		ukf1.metrics_ = metrics.get();
+		ukf1.track_id_ = 0;
+		car1.setUKF(ukf1);
+	}
+	traffic.push_back(car1);
+	
+	Car car2(Vect3(25, -4, 0), Vect3(4, 2, 2), Color(0, 0, 1), -6, 0, 2, "car2");
+	std::vector<accuation> car2_instructions;
+	a = accuation(4.0*1e6, 3.0, 0.0);
+	car2_instructions.push_back(a);
+	a = accuation(8.0*1e6, 0.0, 0.0);
+	car2_instructions.push_back(a);
+	car2.setInstructions(car2_instructions);
+	if( trackCars[1] )
+	{
+		UKF ukf2;
+		ukf2.use_sqrt_ = use_sqrt_ukf;
+		ukf2.metrics_ = metrics.get();
+		ukf2.track_id_ = 1;
+		car2.setUKF(ukf2);
+	}
+	traffic.push_back(car2);
+
+	Car car3(Vect3(-12, 0, 0), Vect3(4, 2, 2), Color(0, 0, 1), 1, 0, 2, "car3");
+	std::vector<accuation> car3_instructions;
+	a = accuation(0.5*1e6, 2.0, 1.0);
+	car3_instructions.push_back(a);
+	a = accuation(1.0*1e6, 2.5, 0.0);
+	car3_instructions.push_back(a);
+	a = accuation(3.2*1e6, 0.0, -1.0);
+	car3_instructions.push_back(a);
+	a = accuation(3.3*1e6, 2.0, 0.0);
+	car3_instructions.push_back(a);
+	a = accuation(4.5*1e6, 0.0, 0.0);
+	car3_instructions.push_back(a);
+	a = accuation(5.5*1e6, -2.0, 0.0);
+	car3_instructions.push_back(a);
+	a = accuation(7.5*1e6, 0.0, 0.0);
+	car3_instructions.push_back(a);
+	car3.setInstructions(car3_instructions);
+	if( trackCars[2] )
+	{
+		UKF ukf3;
+		ukf3.use_sqrt_ = use_sqrt_ukf;
+		ukf3.metrics_ = metrics.get();
+		ukf3.track_id_ = 2;
+		car3.setUKF(ukf3);
+	}
+	traffic.push_back(car3);
+
+	lidarMarkers.assign(traffic.size(), lmarker(0, 0));
+	radarMarkers.assign(traffic.size(), rmarker(0, 0, 0));
+	imm.resize(traffic.size());
+}
+
+HighwaySim::~HighwaySim() {}
+
+void HighwaySim::step(long long timestamp, int frame_per_sec)
+{
+	UKF_TRACE_SCOPE("frame");
+	// the IMM bank replaces the UKFs, which would only burn CPU
+	sensors.feedFilters = !use_imm;
+	sensors.drawNoise(timestamp, traffic.size());
+	for (int i = 0; i < (int)traffic.size(); i++)
+	{
+		{
+			UKF_TRACE_SCOPE("car_move");
+			traffic[i].move((double)1/frame_per_sec, timestamp);
+		}
+		// Sense surrounding cars with lidar and radar
+		if(trackCars[i])
+		{
+			lidarMarkers[i] = sensors.lidarSense(traffic[i], timestamp, i);
+			radarMarkers[i] = sensors.radarSense(traffic[i], egoCar, timestamp, i);
+		}
+	}
+
+	// update all tracks in parallel
+	if(scheduler)
+	{
+		UKF_TRACE_SCOPE("tracking");
+		scheduler->run();
+		scheduler->clear();
+	}
+
+	if(use_imm)
+	{
+		UKF_TRACE_SCOPE("imm");
+		for (int i = 0; i < (int)traffic.size(); i++)
+		{
+			if(!trackCars[i])
+				continue;
+			MeasurementPackage lidar;
+			lidar.sensor_type_ = MeasurementPackage::LASER;
+			lidar.raw_measurements_ = VectorXd(2);
+			lidar.raw_measurements_ << lidarMarkers[i].x, lidarMarkers[i].y;
+			lidar.timestamp_ = timestamp;
+			imm[i].ProcessMeasurement(lidar);
+
+			MeasurementPackage radar;
+			radar.sensor_type_ = MeasurementPackage::RADAR;
+			radar.raw_measurements_ = VectorXd(3);
+			radar.raw_measurements_ << radarMarkers[i].rho, radarMarkers[i].phi, radarMarkers[i].rho_dot;
+			radar.timestamp_ = timestamp;
+			imm[i].ProcessMeasurement(radar);
+		}
+	}
+
+	if(associate_detections)
+	{
+		UKF_TRACE_SCOPE("association");
+		std::vector<MeasurementPackage> lidarDetections, radarDetections;
+		for (int i = 0; i < (int)traffic.size(); i++)
+		{
+			if(!trackCars[i])
+				continue;
+			MeasurementPackage lidar;
+			lidar.sensor_type_ = MeasurementPackage::LASER;
+			lidar.raw_measurements_ = VectorXd(2);
+			lidar.raw_measurements_ << lidarMarkers[i].x, lidarMarkers[i].y;
+			lidar.timestamp_ = timestamp;
+			lidarDetections.push_back(lidar);
+
+			MeasurementPackage radar;
+			radar.sensor_type_ = MeasurementPackage::RADAR;
+			radar.raw_measurements_ = VectorXd(3);
+			radar.raw_measurements_ << radarMarkers[i].rho, radarMarkers[i].phi, radarMarkers[i].rho_dot;
+			radar.timestamp_ = timestamp;
+			radarDetections.push_back(radar);
+		}
+		tracker.update(lidarDetections);
+		tracker.update(radarDetections);
+	}
+
+	// fold this frame's errors into the running RMSE, in track order
+	UKF_TRACE_SCOPE("rmse");
+	for (int i = 0; i < (int)traffic.size(); i++)
+	{
+		if(!trackCars[i])
+			continue;
+		sensors.accuracy.add(i, estimate(i), truth(i));
+	}
+
+	rmse = sensors.accuracy.rmse();
+	if(timestamp > 1.0e6)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			if(rmse[k] > rmseThreshold[k])
+			{
+				rmseFailLog[k] = rmse[k];
+				pass = false;
+			}
+		}
+	}
+}
+
+void HighwaySim::setNoiseSeed(uint64_t seed)
+{
+	noiseSeed = seed;
+	sensors.noiseSource = MeasurementNoise(seed);
+}
+
+void HighwaySim::disableMetrics()
+{
+	for (Car& car : traffic)
+		car.ukf.metrics_ = nullptr;
+	metrics.reset();
+}
+
+Eigen::Vector4d HighwaySim::truth(int i) const
+{
+	const Car& car = traffic[i];
+	Eigen::Vector4d gt;
+	gt << car.position.x, car.position.y, car.velocity*cos(car.angle), car.velocity*sin(car.angle);
+	return gt;
+}
+
+Eigen::Vector4d HighwaySim::estimate(int i) const
+{
+	if(use_imm)
+	{
+		const IMMFilter& filter = imm[i];
+		double v  = filter.x_(2);
+		double yaw = filter.x_(3);
+		Eigen::Vector4d estimate;
+		estimate << filter.x_[0], filter.x_[1], cos(yaw)*v, sin(yaw)*v;
+		return estimate;
+	}
+	const UKF& ukf = traffic[i].ukf;
+	double v  = ukf.x_(2);
+	double yaw = ukf.x_(3);
+	Eigen::Vector4d estimate;
+	estimate << ukf.x_[0], ukf.x_[1], cos(yaw)*v, sin(yaw)*v;
+	return estimate;
+}
+
+double HighwaySim::nisLaser(int i) const
+{
+	return use_imm ? imm[i].nis_laser_ : traffic[i].ukf.nis_laser_;
+}
+
+double HighwaySim::nisRadar(int i) const
+{
+	return use_imm ? imm[i].nis_radar_ : traffic[i].ukf.nis_radar_;
+}
@@ -0,0 +1,87 @@
+/* \author Aaron Brown */
+// Handle logic for creating traffic on highway and animating it,
+// without any rendering so it can also run headless
+
+#ifndef HIGHWAY_SIM_H
+#define HIGHWAY_SIM_H
+#include <memory>
+#include <string>
+#include <vector>
+#include "car.h"
+#include "imm.h"
+#include "sensor_sim.h"
+#include "metrics.h"
+#include "tracking_scheduler.h"
+#include "trace.h"
+#include "track_manager.h"
+
+class HighwaySim
+{
+public:
+
+	std::vector<Car> traffic;
+	Car egoCar;
+	SensorSim sensors;
+	bool pass = true;
+	std::vector<double> rmseThreshold = {0.30,0.16,0.95,0.70};
+	std::vector<double> rmseFailLog = {0.0,0.0,0.0,0.0};
+	// RMSE over all estimates so far, updated by step(); per track and
+	// windowed RMSE are available from sensors.accuracy
+	VectorXd rmse = VectorXd::Zero(4);
+	// last measurements of each tracked car, indexed like traffic
+	std::vector<lmarker> lidarMarkers;
+	std::vector<rmarker> radarMarkers;
+	std::unique_ptr<MetricsSink> metrics;
+	std::unique_ptr<TrackingScheduler> scheduler;
+	// tracks built from the same measurements without car labels, if
+	// associate_detections is set
+	TrackManager tracker;
+	// IMM filter of each car, indexed like traffic, fed the measurements
+	// instead of the cars' UKFs if use_imm is set
+	std::vector<IMMFilter> imm;
+
+	// Parameters 
+	// --------------------------------
+	// Set which cars to track with UKF
+	std::vector<bool> trackCars = {true,true,true};
+	// Track with the square-root UKF instead of the standard one; the UKFs
+	// are built with it, so it is set through the constructor
+	bool use_sqrt_ukf = false;
+	// Record NIS, innovations and update latency of every UKF update
+	bool log_metrics = true;
+	std::string metricsFile = "ukf_metrics.csv";
+	// Worker threads for UKF updates, 0 for one per core, 1 to update inline
+	unsigned trackingThreads = 0;
+	// Samples per track in the windowed RMSE, 0 for cumulative only
+	int rmseWindow = 0;
+	// Keep every estimate and ground truth sample, memory grows with run time
+	bool keep_history = false;
+	// Seed of the measurement noise, a run is reproducible for a given seed
+	uint64_t noiseSeed = 2;
+	// Also feed the measurements, unlabeled, to the multi-target tracker
+	bool associate_detections = false;
+	// Track with the CV/CTRV/CTRA IMM bank instead of the UKFs
+	bool use_imm = false;
+	// --------------------------------
+
+	explicit HighwaySim(bool sqrtUkf = false);
+	virtual ~HighwaySim();
+
+	// move the traffic one frame, sense and track it, and check the RMSE
+	void step(long long timestamp, int frame_per_sec);
+
+	// reseeds the measurement noise, before the first step
+	void setNoiseSeed(uint64_t seed);
+	// stops recording UKF metrics, for runs that collect their own results
+	void disableMetrics();
+
+	// ground truth and UKF (or IMM, if use_imm is set) estimate of car i as
+	// px, py, vx, vy
+	Eigen::Vector4d truth(int i) const;
+	Eigen::Vector4d estimate(int i) const;
+	// NIS of the latest laser and radar update of car i's UKF or IMM
+	double nisLaser(int i) const;
+	double nisRadar(int i) const;
+};
+
+#endif /* HIGHWAY_SIM_H */
@@ -0,0 +1,485 @@
+#include "imm.h"
+#include <algorithm>
+#include <cmath>
+#include "ctrv_kernel.h"
+#include "innovation.h"
+#include "trace.h"
+
+using Eigen::Matrix;
+
+namespace {
+
+// angle normalization into [-pi, pi) without data dependent branches
+struct NormalizeAngle {
+  typedef double result_type;
+  double operator()(double a) const {
+    return a - 2. * M_PI * std::floor((a + M_PI) / (2. * M_PI));
+  }
+};
+
+// angle normalization into [-pi, pi] as UKF does it; cheaper than the floor
+// above, a libm call on the SSE2 baseline, for angles that are rarely out of
+// range, like sigma point offsets from their mean
+inline double WrapAngle(double a) {
+  while (a > M_PI) a -= 2. * M_PI;
+  while (a < -M_PI) a += 2. * M_PI;
+  return a;
+}
+
+// a - b with the yaw component wrapped
+IMMFilter::StateVector StateDiff(const IMMFilter::StateVector& a, const IMMFilter::StateVector& b) {
+  IMMFilter::StateVector d = a - b;
+  d(3) = NormalizeAngle()(d(3));
+  return d;
+}
+
+// 1 in the columns of the bank whose model turns, accelerates
+struct BankMasks {
+  double turn[IMMFilter::n_bank_];
+  double accel[IMMFilter::n_bank_];
+
+  BankMasks() {
+    for (int i = 0; i < IMMFilter::n_bank_; ++i) {
+      int m = i / IMMFilter::n_sig_;
+      turn[i] = m == IMMFilter::CTRV || m == IMMFilter::CTRA;
+      accel[i] = m == IMMFilter::CTRA;
+    }
+  }
+};
+
+const BankMasks kBankMasks;
+
+}  // namespace
+
+/**
+ * Initializes the bank, process noise tuned on the highway scenario
+ */
+IMMFilter::IMMFilter() {
+
+  is_initialized_ = false;
+  time_us_ = 0;
+
+  x_.fill(0.0);
+  P_.fill(0.0);
+  nis_laser_ = 0.0;
+  nis_radar_ = 0.0;
+  for (int m = 0; m < n_models_; ++m) {
+    x_model_[m].fill(0.0);
+    P_model_[m].fill(0.0);
+  }
+  Xsig_pred_.fill(0.0);
+
+  // CV holds speed and heading, small accelerations only
+  std_long_[CV] = 0.3;
+  std_yawdd_[CV] = 0.1;
+  sojourn_[CV] = 4;
+
+  // CTRV, noisier than UKF's since CV covers the quiet stretches
+  std_long_[CTRV] = 2;
+  std_yawdd_[CTRV] = 2;
+  sojourn_[CTRV] = 2;
+
+  // CTRA, acceleration changes through jerk
+  std_long_[CTRA] = 3;
+  std_yawdd_[CTRA] = 2;
+  sojourn_[CTRA] = 2;
+
+  // start undecided between the models
+  mu_.fill(1.0 / n_models_);
+  mu_pred_ = mu_;
+
+  /**
+   * DO NOT MODIFY measurement noise values below.
+   * These are provided by the sensor manufacturer.
+   */
+
+  // Laser measurement noise standard deviation position1 in m
+  std_laspx_ = 0.15;
+
+  // Laser measurement noise standard deviation position2 in m
+  std_laspy_ = 0.15;
+
+  // Radar measurement noise standard deviation radius in m
+  std_radr_ = 0.3;
+
+  // Radar measurement noise standard deviation angle in rad
+  std_radphi_ = 0.03;
+
+  // Radar measurement noise standard deviation radius change in m/s
+  std_radrd_ = 0.3;
+
+  /**
+   * End DO NOT MODIFY section for measurement noise values
+   */
+
+  // Sigma point spreading parameter
+  lambda_ = 3 - n_aug_;
+
+  // Weights of sigma points
+  weights_(0) = lambda_ / (lambda_ + n_aug_);
+  for (int i = 1; i < n_sig_; ++i) {
+    weights_(i) = 0.5 / (lambda_ + n_aug_);
+  }
+}
+
+IMMFilter::~IMMFilter() {}
+
+void IMMFilter::ProcessMeasurement(const MeasurementPackage& meas_package) {
+  UKF_TRACE_SCOPE("imm_process");
+
+  if (!is_initialized_) {
+
+    time_us_ = meas_package.timestamp_;
+
+    // same initial state and covariance as UKF, plus an unknown acceleration
+    StateVector x;
+    StateMatrix P;
+    x.fill(0.0);
+    P.setIdentity();
+    if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
+      x(0) = meas_package.raw_measurements_(0);
+      x(1) = meas_package.raw_measurements_(1);
+      x(2) = 0.2;
+      P(0, 0) = 0.01;
+      P(1, 1) = 0.01;
+    } else {
+      double rho     = meas_package.raw_measurements_(0);
+      double phi     = meas_package.raw_measurements_(1);
+      double rho_dot = meas_package.raw_measurements_(2);
+      x(0) = rho * cos(phi);
+      x(1) = rho * sin(phi);
+      x(2) = rho_dot;
+      x(3) = phi;
+      P(0, 0) = 0.01;
+      P(1, 1) = 0.01;
+      P(2, 2) = 0.01;
+      P(3, 3) = 0.09;
+      P(4, 4) = 0.09;
+    }
+    for (int m = 0; m < n_models_; ++m) {
+      x_model_[m] = x;
+      P_model_[m] = P;
+    }
+    x_ = x;
+    P_ = P;
+
+    is_initialized_ = true;
+    return;
+  }
+
+  double dt = (meas_package.timestamp_ - time_us_) / 1000000.0;
+
+  Prediction(dt);
+
+  if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
+    UpdateLidar(meas_package);
+  }
+  if (meas_package.sensor_type_ == MeasurementPackage::RADAR) {
+    UpdateRadar(meas_package);
+  }
+
+  time_us_ = meas_package.timestamp_;
+}
+
+void IMMFilter::Mix(double delta_t) {
+
+  mu_pred_ = mu_;
+  if (delta_t <= 0) {
+    return;
+  }
+
+  // transition probabilities over delta_t, a model is left at rate
+  // 1 / sojourn towards the others alike
+  Matrix<double, n_models_, n_models_> p;
+  for (int i = 0; i < n_models_; ++i) {
+    double stay = exp(-delta_t / sojourn_[i]);
+    for (int j = 0; j < n_models_; ++j) {
+      p(i, j) = i == j ? stay : (1 - stay) / (n_models_ - 1);
+    }
+  }
+
+  // offsets of the model means from model 0's, yaw wrapped, and the second
+  // moments M_i = P_i + e_i * e_i^T; every mixed covariance is then a
+  // weighted sum of the M_i less the outer product of its mixed offset
+  const StateVector x_ref = x_model_[0];
+  Matrix<double, n_x_, n_models_> e;
+  Matrix<double, n_x_, n_x_> M[n_models_];
+  for (int i = 0; i < n_models_; ++i) {
+    e.col(i) = StateDiff(x_model_[i], x_ref);
+    M[i] = P_model_[i];
+    M[i].noalias() += e.col(i) * e.col(i).transpose();
+  }
+
+  for (int j = 0; j < n_models_; ++j) {
+    double c = 0;
+    for (int i = 0; i < n_models_; ++i) {
+      c += p(i, j) * mu_(i);
+    }
+    mu_pred_(j) = c;
+
+    // probability of having been in model i given model j now
+    Matrix<double, n_models_, 1> w;
+    for (int i = 0; i < n_models_; ++i) {
+      w(i) = p(i, j) * mu_(i) / c;
+    }
+
+    Matrix<double, n_x_, 1> e_mix = e * w;
+    Matrix<double, n_x_, n_x_> P = w(0) * M[0];
+    for (int i = 1; i < n_models_; ++i) {
+      P += w(i) * M[i];
+    }
+    P.noalias() -= e_mix * e_mix.transpose();
+
+    x_model_[j] = x_ref + e_mix;
+    x_model_[j](3) = NormalizeAngle()(x_model_[j](3));
+    P_model_[j] = P;
+  }
+}
+
+void IMMFilter::Prediction(double delta_t) {
+
+  Mix(delta_t);
+
+  /**
+  *  Generate sigma points for the augmented states of every model
+  */
+  // the process noise block is diagonal and uncorrelated with the state, so
+  // only the state block needs factoring; the three factors are taken in one
+  // pass, column by column across the models, of (lambda + n_aug) * P so the
+  // factor columns are the sigma point offsets as they are
+  double L[n_models_][n_x_][n_x_];
+  const double scale = lambda_ + n_aug_;
+  for (int c = 0; c < n_x_; ++c) {
+    for (int m = 0; m < n_models_; ++m) {
+      double d = scale * P_model_[m](c, c);
+      for (int k = 0; k < c; ++k) {
+        d -= L[m][k][c] * L[m][k][c];
+      }
+      // a covariance that lost definiteness to rounding spreads no points
+      // along the lost direction
+      const double l = d > 0 ? std::sqrt(d) : 0;
+      const double inv = l > 0 ? 1 / l : 0;
+      L[m][c][c] = l;
+      for (int r = c + 1; r < n_x_; ++r) {
+        double a = scale * P_model_[m](r, c);
+        for (int k = 0; k < c; ++k) {
+          a -= L[m][k][r] * L[m][k][c];
+        }
+        L[m][c][r] = a * inv;
+      }
+    }
+  }
+
+  Matrix<double, n_aug_, n_bank_> Xsig_aug;
+  const double sqrt_scale = sqrt(scale);
+  for (int m = 0; m < n_models_; ++m) {
+    double* X = Xsig_aug.data() + m * n_sig_ * n_aug_;
+    for (int i = 0; i < n_sig_; ++i) {
+      for (int r = 0; r < n_x_; ++r) {
+        X[i * n_aug_ + r] = x_model_[m](r);
+      }
+      X[i * n_aug_ + n_x_] = 0;
+      X[i * n_aug_ + n_x_ + 1] = 0;
+    }
+    for (int c = 0; c < n_x_; ++c) {
+      for (int r = c; r < n_x_; ++r) {
+        X[(1 + c) * n_aug_ + r] += L[m][c][r];
+        X[(1 + c + n_aug_) * n_aug_ + r] -= L[m][c][r];
+      }
+    }
+    X[(1 + n_x_) * n_aug_ + n_x_] = sqrt_scale * std_long_[m];
+    X[(1 + n_x_ + n_aug_) * n_aug_ + n_x_] = -sqrt_scale * std_long_[m];
+    X[(2 + n_x_) * n_aug_ + n_x_ + 1] = sqrt_scale * std_yawdd_[m];
+    X[(2 + n_x_ + n_aug_) * n_aug_ + n_x_ + 1] = -sqrt_scale * std_yawdd_[m];
+  }
+
+  // nothing moves over a zero step, e.g. radar after lidar in the same
+  // frame: the sigma points are the prediction and their moments are the
+  // unchanged model states and covariances
+  if (delta_t == 0) {
+    Xsig_pred_ = Xsig_aug.topRows<n_x_>();
+    return;
+  }
+
+  /**
+  *  Apply the motion models to the whole bank at once; CTRA with the turn
+  *  rate masked out for CV and the acceleration masked out for CV and CTRV.
+  *  The longitudinal noise is an acceleration for CV and CTRV and a jerk
+  *  for CTRA.
+  */
+  ctrv::PredictMaskedSigmaPoints(Xsig_aug.data(), n_aug_, Xsig_pred_.data(), n_x_,
+                                 kBankMasks.turn, kBankMasks.accel, n_bank_, delta_t);
+
+  /**
+  *  Get predicted mean and covariance of every model
+  */
+  // all weights but the first are equal, so P = w_1 * D * D^T plus a rank
+  // one correction for the mean column; the products are this small and
+  // symmetric, so only the lower triangle is summed, over flat columns
+  const double w_0 = weights_(0), w_1 = weights_(1);
+  for (int m = 0; m < n_models_; ++m) {
+    const double* X = Xsig_pred_.data() + m * n_sig_ * n_x_;
+
+    double x[n_x_];
+    for (int r = 0; r < n_x_; ++r) {
+      double sum = 0;
+      for (int i = 1; i < n_sig_; ++i) {
+        sum += X[i * n_x_ + r];
+      }
+      x[r] = w_0 * X[r] + w_1 * sum;
+    }
+
+    double D[n_sig_][n_x_];
+    for (int i = 0; i < n_sig_; ++i) {
+      for (int r = 0; r < n_x_; ++r) {
+        D[i][r] = X[i * n_x_ + r] - x[r];
+      }
+      D[i][3] = WrapAngle(D[i][3]);
+    }
+
+    double P[n_x_][n_x_] = {};
+    for (int i = 1; i < n_sig_; ++i) {
+      for (int c = 0; c < n_x_; ++c) {
+        for (int r = c; r < n_x_; ++r) {
+          P[c][r] += D[i][r] * D[i][c];
+        }
+      }
+    }
+    for (int c = 0; c < n_x_; ++c) {
+      x_model_[m](c) = x[c];
+      for (int r = c; r < n_x_; ++r) {
+        P_model_[m](r, c) = P_model_[m](c, r) = w_1 * P[c][r] + w_0 * D[0][r] * D[0][c];
+      }
+    }
+  }
+}
+
+void IMMFilter::UpdateLidar(const MeasurementPackage& meas_package) {
+
+  LidarModel model(std_laspx_, std_laspy_);
+  double log_likelihood[n_models_];
+  Matrix<double, 2, 1> z_pred[n_models_];
+  Matrix<double, 2, 2> S[n_models_];
+  for (int m = 0; m < n_models_; ++m) {
+    // linear model, the moments are blocks of x and P
+    z_pred[m] = x_model_[m].head<2>();
+    S[m] = P_model_[m].topLeftCorner<2, 2>() + model.R();
+    Matrix<double, n_x_, 2> Tc = P_model_[m].leftCols<2>();
+    log_likelihood[m] = UpdateModel(m, model, meas_package, z_pred[m], S[m], Tc);
+  }
+  nis_laser_ = MixtureNis(model, meas_package, z_pred, S);
+  Combine(log_likelihood);
+}
+
+void IMMFilter::UpdateRadar(const MeasurementPackage& meas_package) {
+
+  RadarModel model(std_radr_, std_radphi_, std_radrd_);
+
+  // transform the sigma points of the whole bank into measurement space
+  Matrix<double, 3, n_bank_> Zsig;
+  ctrv::RadarSigmaPoints(Xsig_pred_.data(), n_x_, Zsig.data(), 3, n_bank_);
+
+  double log_likelihood[n_models_];
+  Matrix<double, 3, 1> z_pred[n_models_];
+  Matrix<double, 3, 3> S[n_models_];
+  for (int m = 0; m < n_models_; ++m) {
+    const Matrix<double, n_x_, n_sig_> Xsig = Xsig_pred_.middleCols<n_sig_>(m * n_sig_);
+    const Matrix<double, 3, n_sig_> Z = Zsig.middleCols<n_sig_>(m * n_sig_);
+
+    z_pred[m] = Z * weights_;
+    Matrix<double, 3, n_sig_> Zdiff = Z.colwise() - z_pred[m];
+    Zdiff.row(1) = Zdiff.row(1).unaryExpr(NormalizeAngle());
+    Matrix<double, n_x_, n_sig_> Xdiff = Xsig.colwise() - x_model_[m];
+    Xdiff.row(3) = Xdiff.row(3).unaryExpr(NormalizeAngle());
+
+    Matrix<double, n_sig_, 3> Zweighted = weights_.asDiagonal() * Zdiff.transpose();
+    S[m] = Zdiff.lazyProduct(Zweighted) + model.R();
+    Matrix<double, n_x_, 3> Tc = Xdiff.lazyProduct(Zweighted);
+    log_likelihood[m] = UpdateModel(m, model, meas_package, z_pred[m], S[m], Tc);
+  }
+  nis_radar_ = MixtureNis(model, meas_package, z_pred, S);
+  Combine(log_likelihood);
+}
+
+template <class MeasModel>
+double IMMFilter::UpdateModel(int m, const MeasModel& model, const MeasurementPackage& meas_package,
+                              const Matrix<double, MeasModel::n_z, 1>& z_pred,
+                              const Matrix<double, MeasModel::n_z, MeasModel::n_z>& S,
+                              const Matrix<double, n_x_, MeasModel::n_z>& Tc) {
+
+  const int n_z = MeasModel::n_z;
+
+  // residual
+  Matrix<double, n_z, 1> z_diff = meas_package.raw_measurements_ - z_pred;
+  NormalizeAngles<MeasModel::angle_mask>(z_diff);
+
+  // update state mean and covariance matrix; K*S*K^T = K*Tc^T
+  InnovationSolver<n_z> S_solver(S);
+  Matrix<double, n_x_, n_z> K = S_solver.Gain(Tc);
+  x_model_[m] += K * z_diff;
+  P_model_[m] -= K * Tc.transpose();
+
+  // Gaussian log likelihood of the residual
+  return -0.5 * (S_solver.Nis(z_diff) + log(S.determinant()) + n_z * log(2 * M_PI));
+}
+
+template <class MeasModel>
+double IMMFilter::MixtureNis(const MeasModel& model, const MeasurementPackage& meas_package,
+                             const Matrix<double, MeasModel::n_z, 1> z_pred[n_models_],
+                             const Matrix<double, MeasModel::n_z, MeasModel::n_z> S[n_models_]) const {
+
+  const int n_z = MeasModel::n_z;
+
+  // mean of the predicted measurement mixture, relative to model 0's for
+  // the angle wrap
+  Matrix<double, n_z, 1> z_mix = z_pred[0];
+  for (int m = 1; m < n_models_; ++m) {
+    Matrix<double, n_z, 1> d = z_pred[m] - z_pred[0];
+    NormalizeAngles<MeasModel::angle_mask>(d);
+    z_mix += mu_pred_(m) * d;
+  }
+
+  // covariance of the mixture: model spreads plus the spread of their means
+  Matrix<double, n_z, n_z> S_mix = Matrix<double, n_z, n_z>::Zero();
+  for (int m = 0; m < n_models_; ++m) {
+    Matrix<double, n_z, 1> d = z_pred[m] - z_mix;
+    NormalizeAngles<MeasModel::angle_mask>(d);
+    S_mix += mu_pred_(m) * (S[m] + d * d.transpose());
+  }
+
+  Matrix<double, n_z, 1> z_diff = meas_package.raw_measurements_ - z_mix;
+  NormalizeAngles<MeasModel::angle_mask>(z_diff);
+  return InnovationSolver<n_z>(S_mix).Nis(z_diff);
+}
+
+void IMMFilter::Combine(const double log_likelihood[n_models_]) {
+
+  // model probabilities, scaled by the largest likelihood so none underflows
+  double max_log = log_likelihood[0];
+  for (int m = 1; m < n_models_; ++m) {
+    max_log = std::max(max_log, log_likelihood[m]);
+  }
+  double total = 0;
+  for (int m = 0; m < n_models_; ++m) {
+    mu_(m) = mu_pred_(m) * exp(log_likelihood[m] - max_log);
+    total += mu_(m);
+  }
+  mu_ /= total;
+  // the next update at this timestamp starts from these probabilities
+  mu_pred_ = mu_;
+
+  // combined estimate, relative to the most likely model for the yaw wrap
+  int best = 0;
+  mu_.maxCoeff(&best);
+  x_ = x_model_[best];
+  for (int m = 0; m < n_models_; ++m) {
+    x_ += mu_(m) * StateDiff(x_model_[m], x_model_[best]);
+  }
+  x_(3) = NormalizeAngle()(x_(3));
+
+  P_.fill(0.0);
+  for (int m = 0; m < n_models_; ++m) {
+    StateVector d = StateDiff(x_model_[m], x_);
+    P_ += mu_(m) * (P_model_[m] + d * d.transpose());
+  }
+}
@@ -0,0 +1,161 @@
+#ifndef IMM_H
+#define IMM_H
+
+#include "Eigen/Dense"
+#include "measurement_package.h"
+#include "measurement_models.h"
+
+/**
+ * Interacting multiple model filter over a bank of three unscented filters:
+ * constant velocity (CV), constant turn rate and velocity (CTRV) and
+ * constant turn rate and acceleration (CTRA).
+ *
+ * All models share the state [p_x p_y v yaw yawd a]. CV ignores yawd and a
+ * and CTRV ignores a; the components a model ignores ride along unchanged,
+ * so every model covariance stays full rank and mixing needs no special
+ * cases. Models switch as a continuous time Markov chain with a mean
+ * sojourn time per model, so a second update at the same timestamp mixes
+ * nothing.
+ *
+ * The bank is evaluated as one filter: the sigma points of all three models
+ * sit side by side in one matrix and are propagated in a single pass with
+ * per-column turn and acceleration masks, and the radar transform runs over
+ * all of them at once. Lidar updates are linear and take the closed form.
+ */
+class IMMFilter {
+ public:
+  static const int n_models_ = 3;
+  static const int n_x_ = 6;
+  static const int n_aug_ = 8;
+  // sigma points per model and in the whole bank
+  static const int n_sig_ = 2 * n_aug_ + 1;
+  static const int n_bank_ = n_models_ * n_sig_;
+
+  enum Model { CV, CTRV, CTRA };
+
+  // unaligned, filters are kept by value in std::vector
+  typedef Eigen::Matrix<double, n_x_, 1, Eigen::DontAlign> StateVector;
+  typedef Eigen::Matrix<double, n_x_, n_x_, Eigen::DontAlign> StateMatrix;
+  typedef Eigen::Matrix<double, n_models_, 1, Eigen::DontAlign> ModelVector;
+  typedef Eigen::Matrix<double, n_x_, n_bank_, Eigen::DontAlign> BankSigmaMatrix;
+
+  /**
+   * Constructor
+   */
+  IMMFilter();
+
+  /**
+   * Destructor
+   */
+  virtual ~IMMFilter();
+
+  /**
+   * ProcessMeasurement
+   * @param meas_package The latest measurement data of either radar or laser
+   */
+  void ProcessMeasurement(const MeasurementPackage& meas_package);
+
+  /**
+   * Mixes the model estimates and predicts every model's sigma points,
+   * state and covariance
+   * @param delta_t Time between k and k+1 in s
+   */
+  void Prediction(double delta_t);
+
+  /**
+   * Updates every model and the model probabilities with a laser measurement
+   * @param meas_package The measurement at k+1
+   */
+  void UpdateLidar(const MeasurementPackage& meas_package);
+
+  /**
+   * Updates every model and the model probabilities with a radar measurement
+   * @param meas_package The measurement at k+1
+   */
+  void UpdateRadar(const MeasurementPackage& meas_package);
+
+  // initially set to false, set to true in first call of ProcessMeasurement
+  bool is_initialized_;
+
+  // combined state vector: [pos1 pos2 vel_abs yaw_angle yaw_rate accel]
+  StateVector x_;
+
+  // combined state covariance matrix
+  StateMatrix P_;
+
+  // model probabilities, indexed by Model
+  ModelVector mu_;
+
+  // NIS of the latest laser and radar update, against the bank's predicted
+  // measurement mixture
+  double nis_laser_;
+  double nis_radar_;
+
+  // state and covariance of each model
+  StateVector x_model_[n_models_];
+  StateMatrix P_model_[n_models_];
+
+  // predicted sigma points, model m in columns m * n_sig_ .. (m + 1) * n_sig_ - 1
+  BankSigmaMatrix Xsig_pred_;
+
+  // time when the state is true, in us
+  long long time_us_;
+
+  // Process noise standard deviation along the heading, acceleration for
+  // CV and CTRV in m/s^2 and jerk for CTRA in m/s^3
+  double std_long_[n_models_];
+
+  // Process noise standard deviation yaw acceleration in rad/s^2
+  double std_yawdd_[n_models_];
+
+  // mean time the target stays in each model in s
+  double sojourn_[n_models_];
+
+  // Laser measurement noise standard deviation position1 in m
+  double std_laspx_;
+
+  // Laser measurement noise standard deviation position2 in m
+  double std_laspy_;
+
+  // Radar measurement noise standard deviation radius in m
+  double std_radr_;
+
+  // Radar measurement noise standard deviation angle in rad
+  double std_radphi_;
+
+  // Radar measurement noise standard deviation radius change in m/s
+  double std_radrd_;
+
+  // Sigma point spreading parameter
+  double lambda_;
+
+ private:
+  // model m's initial states and covariances from the mixing step
+  void Mix(double delta_t);
+
+  // updates model m from its predicted measurement moments and returns the
+  // log likelihood of the measurement
+  template <class MeasModel>
+  double UpdateModel(int m, const MeasModel& model, const MeasurementPackage& meas_package,
+                     const Eigen::Matrix<double, MeasModel::n_z, 1>& z_pred,
+                     const Eigen::Matrix<double, MeasModel::n_z, MeasModel::n_z>& S,
+                     const Eigen::Matrix<double, n_x_, MeasModel::n_z>& Tc);
+
+  // NIS of the measurement against the mixture of the models' predicted
+  // measurements, weighted by the predicted model probabilities
+  template <class MeasModel>
+  double MixtureNis(const MeasModel& model, const MeasurementPackage& meas_package,
+                    const Eigen::Matrix<double, MeasModel::n_z, 1> z_pred[n_models_],
+                    const Eigen::Matrix<double, MeasModel::n_z, MeasModel::n_z> S[n_models_]) const;
+
+  // model probabilities from the update likelihoods, then the combined estimate
+  void Combine(const double log_likelihood[n_models_]);
+
+  // Weights of sigma points
+  Eigen::Matrix<double, n_sig_, 1, Eigen::DontAlign> weights_;
+
+  // predicted model probabilities of the last mixing step
+  ModelVector mu_pred_;
+};
+
+#endif  // IMM_H
@@ -0,0 +1,88 @@
+#ifndef INNOVATION_H
+#define INNOVATION_H
+
+#include "Eigen/Dense"
+
+/**
+ * Factorization of an innovation covariance S, computed once per update and
+ * reused for the Kalman gain K = Tc * S^-1 and the NIS z^T * S^-1 * z.
+ * The general case uses LDLT; 2x2 (lidar) and 3x3 (radar) are specialized
+ * with a closed-form symmetric inverse.
+ * @tparam NZ Measurement dimension
+ */
+template <int NZ>
+class InnovationSolver {
+ public:
+  typedef Eigen::Matrix<double, NZ, NZ> CovMatrix;
+  typedef Eigen::Matrix<double, NZ, 1> MeasVector;
+
+  explicit InnovationSolver(const CovMatrix& S) : ldlt_(S) {}
+
+  template <int NX>
+  Eigen::Matrix<double, NX, NZ> Gain(const Eigen::Matrix<double, NX, NZ>& Tc) const {
+    return ldlt_.solve(Tc.transpose()).transpose();
+  }
+
+  double Nis(const MeasVector& z_diff) const {
+    return z_diff.dot(ldlt_.solve(z_diff));
+  }
+
+ private:
+  Eigen::LDLT<CovMatrix> ldlt_;
+};
+
+/**
+ * Shared part of the closed-form specializations, which keep S^-1 itself
+ */
+template <int NZ>
+class InnovationInverse {
+ public:
+  typedef Eigen::Matrix<double, NZ, NZ> CovMatrix;
+  typedef Eigen::Matrix<double, NZ, 1> MeasVector;
+
+  template <int NX>
+  Eigen::Matrix<double, NX, NZ> Gain(const Eigen::Matrix<double, NX, NZ>& Tc) const {
+    return Tc * Sinv_;
+  }
+
+  double Nis(const MeasVector& z_diff) const {
+    return z_diff.dot(Sinv_ * z_diff);
+  }
+
+ protected:
+  CovMatrix Sinv_;
+};
+
+template <>
+class InnovationSolver<2> : public InnovationInverse<2> {
+ public:
+  explicit InnovationSolver(const CovMatrix& S) {
+    double inv_det = 1.0 / (S(0, 0) * S(1, 1) - S(0, 1) * S(1, 0));
+    Sinv_(0, 0) =  S(1, 1) * inv_det;
+    Sinv_(0, 1) = -S(0, 1) * inv_det;
+    Sinv_(1, 0) =  Sinv_(0, 1);
+    Sinv_(1, 1) =  S(0, 0) * inv_det;
+  }
+};
+
+template <>
+class InnovationSolver<3> : public InnovationInverse<3> {
+ public:
+  explicit InnovationSolver(const CovMatrix& S) {
+    // cofactors of the symmetric S
+    double c00 = S(1, 1) * S(2, 2) - S(1, 2) * S(1, 2);
+    double c01 = S(0, 2) * S(1, 2) - S(0, 1) * S(2, 2);
+    double c02 = S(0, 1) * S(1, 2) - S(0, 2) * S(1, 1);
+    double c11 = S(0, 0) * S(2, 2) - S(0, 2) * S(0, 2);
+    double c12 = S(0, 1) * S(0, 2) - S(0, 0) * S(1, 2);
+    double c22 = S(0, 0) * S(1, 1) - S(0, 1) * S(0, 1);
+    double inv_det = 1.0 / (S(0, 0) * c00 + S(0, 1) * c01 + S(0, 2) * c02);
+
+    Sinv_ << c00, c01, c02,
+             c01, c11, c12,
+             c02, c12, c22;
+    Sinv_ *= inv_det;
+  }
+};
+
+#endif  // INNOVATION_H
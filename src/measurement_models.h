@@ -0,0 +1,123 @@
+#ifndef MEASUREMENT_MODELS_H
+#define MEASUREMENT_MODELS_H
+
+#include <cmath>
+#include "Eigen/Dense"
+
+/**
+ * Measurement models for UnscentedKalmanFilter::UnscentedUpdate.
+ *
+ * A model provides
+ *   n_z         measurement dimension
+ *   angle_mask  bit i set if measurement component i is an angle
+ *   linear      true if h(x) = H x, in which case it also provides H<NX>()
+ *               and the filter takes the closed-form Kalman update
+ *   selection   for linear models, true if H = [I 0], so the update only
+ *               reads the leading blocks of x and P
+ *   h(x)        the measurement function for one state
+ *   R()         the measurement noise covariance
+ * To add a sensor, add a model here and instantiate UnscentedUpdate for it
+ * at the bottom of ukf.cpp.
+ */
+
+// wraps the components of v flagged in Mask into [-pi, pi]
+template <unsigned Mask, typename Derived>
+inline void NormalizeAngles(Eigen::MatrixBase<Derived>& v) {
+  for (int i = 0; i < v.size(); ++i) {
+    if (Mask & (1u << i)) {
+      while (v(i)> M_PI) v(i)-=2.*M_PI;
+      while (v(i)<-M_PI) v(i)+=2.*M_PI;
+    }
+  }
+}
+
+/**
+ * Lidar: [p_x p_y], a selection of the first two state components
+ */
+struct LidarModel {
+  static constexpr int n_z = 2;
+  static constexpr unsigned angle_mask = 0;
+  static constexpr bool linear = true;
+  static constexpr bool selection = true;
+
+  LidarModel(double std_px, double std_py) : std_px_(std_px), std_py_(std_py) {}
+
+  template <typename Derived>
+  Eigen::Matrix<double, n_z, 1> h(const Eigen::MatrixBase<Derived>& x) const {
+    return x.template head<n_z>();
+  }
+
+  template <int NX>
+  Eigen::Matrix<double, n_z, NX> H() const {
+    Eigen::Matrix<double, n_z, NX> H = Eigen::Matrix<double, n_z, NX>::Zero();
+    H(0, 0) = 1;
+    H(1, 1) = 1;
+    return H;
+  }
+
+  Eigen::Matrix<double, n_z, n_z> R() const {
+    Eigen::Matrix<double, n_z, n_z> R;
+    R <<  std_px_ * std_px_,            0,
+                   0,             std_py_ * std_py_;
+    return R;
+  }
+
+  double std_px_;
+  double std_py_;
+};
+
+/**
+ * Lidar through the sigma points instead of the closed form; the reference
+ * the closed-form lidar update is verified against
+ */
+struct LidarSigmaPointModel : LidarModel {
+  static constexpr bool linear = false;
+  static constexpr bool selection = false;
+
+  LidarSigmaPointModel(double std_px, double std_py) : LidarModel(std_px, std_py) {}
+};
+
+/**
+ * Radar: [rho phi rho_dot] of a CTRV state [p_x p_y v yaw ...]
+ */
+struct RadarModel {
+  static constexpr int n_z = 3;
+  static constexpr unsigned angle_mask = 1u << 1;
+  static constexpr bool linear = false;
+  static constexpr bool selection = false;
+
+  RadarModel(double std_r, double std_phi, double std_rd)
+    : std_r_(std_r), std_phi_(std_phi), std_rd_(std_rd) {}
+
+  template <typename Derived>
+  Eigen::Matrix<double, n_z, 1> h(const Eigen::MatrixBase<Derived>& x) const {
+    // extract values for better readability
+    double p_x = x(0);
+    double p_y = x(1);
+    double v   = x(2);
+    double yaw = x(3);
+
+    double v1 = cos(yaw)*v;
+    double v2 = sin(yaw)*v;
+
+    Eigen::Matrix<double, n_z, 1> z;
+    z(0) = sqrt(p_x * p_x + p_y * p_y);                           // r
+    z(1) = atan2(p_y, p_x);                                       // phi
+    z(2) = (p_x * v1 + p_y * v2) / sqrt(p_x * p_x + p_y * p_y);   // r_dot
+    return z;
+  }
+
+  Eigen::Matrix<double, n_z, n_z> R() const {
+    Eigen::Matrix<double, n_z, n_z> R;
+    R <<  std_r_ * std_r_,            0,                   0,
+                 0,             std_phi_ * std_phi_,       0,
+                 0,                   0,             std_rd_ * std_rd_;
+    return R;
+  }
+
+  double std_r_;
+  double std_phi_;
+  double std_rd_;
+};
+
+#endif  // MEASUREMENT_MODELS_H
@@ -0,0 +1,123 @@
+#include "metrics.h"
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	// ids start at 1 so a zeroed cache entry matches no sink
+	std::atomic<long long> nextSinkId(1);
+
+	// rings of the sinks this thread published to last, replaced round robin;
+	// an evicted sink finds this thread's ring again in its own registry
+	struct RingCacheEntry
+	{
+		long long sinkId;
+		void* ring;
+	};
+	const int kRingCacheSize = 8;
+	thread_local RingCacheEntry ringCache[kRingCacheSize];
+	thread_local int ringCacheNext = 0;
+}
+
+void MetricsSink::RingDeleter::operator()(Ring* ring) const
+{
+	ring->~Ring();
+	std::free(ring);
+}
+
+MetricsSink::MetricsSink(const std::string& file, Format format)
+	: id_(nextSinkId++), format_(format),
+	  out_(file, format == BINARY ? std::ios::out | std::ios::binary : std::ios::out),
+	  running_(true), dropped_(0)
+{
+	if (format_ == CSV)
+		out_ << "track,sensor,timestamp_us,nis,latency_ns,innovation_0,innovation_1,innovation_2\n";
+	writer_ = std::thread(&MetricsSink::writerLoop, this);
+}
+
+MetricsSink::~MetricsSink()
+{
+	running_ = false;
+	writer_.join();
+	drain();
+	out_.flush();
+}
+
+void MetricsSink::publish(const UpdateMetric& metric)
+{
+	if (!localRing()->push(metric))
+		dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+MetricsSink::Ring* MetricsSink::localRing()
+{
+	for (int i = 0; i < kRingCacheSize; i++)
+	{
+		if (ringCache[i].sinkId == id_)
+			return static_cast<Ring*>(ringCache[i].ring);
+	}
+
+	// first publish from this thread, or the cache entry was evicted: the
+	// only locked path
+	std::lock_guard<std::mutex> lock(ringsMutex_);
+	std::thread::id self = std::this_thread::get_id();
+	Ring* ring = nullptr;
+	for (size_t i = 0; i < rings_.size() && !ring; i++)
+	{
+		if (ringOwners_[i] == self)
+			ring = rings_[i].get();
+	}
+	if (!ring)
+	{
+		// Ring holds alignas(64) members, more than operator new guarantees
+		// before C++17
+		void* memory = nullptr;
+		if (posix_memalign(&memory, alignof(Ring), sizeof(Ring)) != 0)
+			throw std::bad_alloc();
+		ring = new (memory) Ring();
+		rings_.emplace_back(ring);
+		ringOwners_.push_back(self);
+	}
+
+	RingCacheEntry& entry = ringCache[ringCacheNext];
+	ringCacheNext = (ringCacheNext + 1) % kRingCacheSize;
+	entry.sinkId = id_;
+	entry.ring = ring;
+	return ring;
+}
+
+void MetricsSink::writerLoop()
+{
+	while (running_)
+	{
+		drain();
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+}
+
+void MetricsSink::drain()
+{
+	std::lock_guard<std::mutex> lock(ringsMutex_);
+	for (std::unique_ptr<Ring, RingDeleter>& ring : rings_)
+		ring->drain([this](const UpdateMetric& metric) { write(metric); });
+}
+
+void MetricsSink::write(const UpdateMetric& metric)
+{
+	if (format_ == BINARY)
+	{
+		out_.write(reinterpret_cast<const char*>(&metric), sizeof(metric));
+		return;
+	}
+
+	out_ << metric.track_id << ',' << metric.sensor << ',' << metric.timestamp_us << ','
+		 << metric.nis << ',' << metric.latency_ns;
+	for (int i = 0; i < 3; i++)
+	{
+		out_ << ',';
+		if (i < metric.n_z)
+			out_ << metric.innovation[i];
+	}
+	out_ << '\n';
+}
@@ -0,0 +1,131 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * One filter update as recorded by the metrics sink
+ */
+struct UpdateMetric
+{
+	long long timestamp_us;
+	int track_id;
+	// MeasurementPackage::SensorType of the update
+	int sensor;
+	// number of valid entries in innovation
+	int n_z;
+	double nis;
+	double innovation[3];
+	long long latency_ns;
+};
+
+/**
+ * Single producer / single consumer ring buffer. The producer only writes
+ * head_, the consumer only writes tail_, so neither side ever blocks.
+ * @tparam N Capacity, a power of two
+ */
+template <typename T, size_t N>
+class SpscRing
+{
+	static_assert((N & (N - 1)) == 0, "ring capacity must be a power of two");
+
+public:
+	SpscRing() : head_(0), tail_(0) {}
+
+	// false if the ring is full
+	bool push(const T& item)
+	{
+		size_t head = head_.load(std::memory_order_relaxed);
+		if (head - tail_.load(std::memory_order_acquire) == N)
+			return false;
+		buffer_[head & (N - 1)] = item;
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// hands every queued item to f, returns how many there were
+	template <typename F>
+	size_t drain(F f)
+	{
+		size_t tail = tail_.load(std::memory_order_relaxed);
+		size_t head = head_.load(std::memory_order_acquire);
+		size_t count = head - tail;
+		for (; tail != head; ++tail)
+			f(buffer_[tail & (N - 1)]);
+		tail_.store(tail, std::memory_order_release);
+		return count;
+	}
+
+private:
+	T buffer_[N];
+	alignas(64) std::atomic<size_t> head_;
+	alignas(64) std::atomic<size_t> tail_;
+};
+
+/**
+ * Collects UpdateMetric records from any number of filter threads and writes
+ * them to a file from a background thread.
+ *
+ * Publish() is lock-free: each publishing thread gets its own SPSC ring the
+ * first time it publishes, found again through a small per-thread cache of
+ * sink to ring, and records are dropped (and counted) rather than
+ * blocking when a ring is full. The writer thread drains all rings every few
+ * milliseconds and on destruction.
+ */
+class MetricsSink
+{
+public:
+	enum Format
+	{
+		CSV,
+		BINARY
+	};
+
+	MetricsSink(const std::string& file, Format format = CSV);
+	~MetricsSink();
+
+	MetricsSink(const MetricsSink&) = delete;
+	MetricsSink& operator=(const MetricsSink&) = delete;
+
+	void publish(const UpdateMetric& metric);
+
+	// records lost to full rings so far
+	long long dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+	typedef SpscRing<UpdateMetric, 4096> Ring;
+
+	// rings are allocated with posix_memalign for their cache line alignment
+	struct RingDeleter
+	{
+		void operator()(Ring* ring) const;
+	};
+
+	Ring* localRing();
+	void writerLoop();
+	void drain();
+	void write(const UpdateMetric& metric);
+
+	// distinguishes sinks in the per-thread ring cache
+	const long long id_;
+	const Format format_;
+	std::ofstream out_;
+
+	std::mutex ringsMutex_;
+	std::vector<std::unique_ptr<Ring, RingDeleter> > rings_;
+	// publishing thread of each ring
+	std::vector<std::thread::id> ringOwners_;
+
+	std::atomic<bool> running_;
+	std::atomic<long long> dropped_;
+	std::thread writer_;
+};
+
+#endif /* METRICS_H */
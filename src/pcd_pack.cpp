@@ -0,0 +1,47 @@
+// Pack a directory of <name>_<timestamp>.pcd files into one PCD container
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sensors/pcd_container.h"
+
+int main(int argc, char** argv)
+{
+	if(argc < 3)
+	{
+		std::cerr << "usage: " << argv[0] << " <pcd directory> <output container> [--compress]" << std::endl;
+		return 2;
+	}
+	std::string directory = argv[1];
+	std::string output = argv[2];
+	bool compress = argc > 3 && std::string(argv[3]) == "--compress";
+	if(compress && !pcdDeflateAvailable())
+		std::cerr << "built without zlib, writing uncompressed frames" << std::endl;
+
+	std::vector<std::pair<long long, std::string> > files;
+	if(!listPcdFrames(directory, files))
+		return 1;
+
+	PcdContainerWriter writer;
+	if(!writer.open(output, compress))
+		return 1;
+	std::vector<float> xyz;
+	size_t points = 0;
+	for(const std::pair<long long, std::string>& file : files)
+	{
+		if(!readPcdXyz(file.second, xyz) || !writer.addFrame(file.first, xyz.data(), xyz.size() / 3))
+		{
+			std::cerr << "Failed to pack " << file.second << std::endl;
+			return 1;
+		}
+		points += xyz.size() / 3;
+	}
+	if(!writer.close())
+	{
+		std::cerr << "Failed to write " << output << std::endl;
+		return 1;
+	}
+	std::cout << "packed " << files.size() << " frames, " << points << " points into " << output << std::endl;
+	return 0;
+}
@@ -4,7 +4,7 @@
 
 #include "render.h"
 
-void renderHighway(double distancePos, pcl::visualization::PCLVisualizer::Ptr& viewer)
+void renderHighway(double distancePos, RenderScene& scene)
 {
 
 	// units in meters
@@ -13,11 +13,10 @@ void renderHighway(double distancePos, pcl::visualization::PCLVisualizer::Ptr& v
 	double roadWidth = 12.0;
 	double roadHeight = 0.2; 
 
-	viewer->addCube(roadLengthBehind, roadLengthAhead, -roadWidth / 2, roadWidth / 2, -roadHeight, 0, .2, .2, .2, "highwayPavement");
-	viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_REPRESENTATION, pcl::visualization::PCL_VISUALIZER_REPRESENTATION_SURFACE, "highwayPavement");
-	viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_OPACITY, 1.0, "highwayPavement");
-	viewer->addLine(pcl::PointXYZ(roadLengthBehind, -roadWidth / 6, 0.01), pcl::PointXYZ(roadLengthAhead , -roadWidth / 6, 0.01), 1, 1, 0, "line1");
-	viewer->addLine(pcl::PointXYZ(roadLengthBehind, roadWidth / 6, 0.01), pcl::PointXYZ(roadLengthAhead, roadWidth / 6, 0.01), 1, 1, 0, "line2");
+	scene.box("highwayPavement", Eigen::Vector3f((roadLengthBehind + roadLengthAhead) / 2, 0, -roadHeight / 2), Eigen::Quaternionf::Identity(),
+		Eigen::Vector3f(roadLengthAhead - roadLengthBehind, roadWidth, roadHeight), Color(.2, .2, .2), false);
+	scene.line("line1", Eigen::Vector3f(roadLengthBehind, -roadWidth / 6, 0.01), Eigen::Vector3f(roadLengthAhead , -roadWidth / 6, 0.01), Color(1, 1, 0));
+	scene.line("line2", Eigen::Vector3f(roadLengthBehind, roadWidth / 6, 0.01), Eigen::Vector3f(roadLengthAhead, roadWidth / 6, 0.01), Color(1, 1, 0));
 
 	// render poles
 	// spacing in meters between poles, poles start at x = 0
@@ -32,19 +31,14 @@ void renderHighway(double distancePos, pcl::visualization::PCLVisualizer::Ptr& v
 	while(markerPos < roadLengthBehind)
 		markerPos+=poleSpace;
 	int poleIndex = 0;
+	Eigen::Vector3f poleSize(poleWidth, poleWidth, poleHeight);
 	while(markerPos <= roadLengthAhead) 
 	{
 		//	left pole
-		viewer->addCube(-poleWidth/2+markerPos, poleWidth/2+markerPos, -poleWidth/2+roadWidth/2+poleCurve, poleWidth/2+roadWidth/2+poleCurve, 0, poleHeight, 1, 0.5, 0, "pole_"+std::to_string(poleIndex)+"l");
-		viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_REPRESENTATION, pcl::visualization::PCL_VISUALIZER_REPRESENTATION_SURFACE, "pole_"+std::to_string(poleIndex)+"l");
-		viewer->addCube(-poleWidth/2+markerPos, poleWidth/2+markerPos, -poleWidth/2+roadWidth/2+poleCurve, poleWidth/2+roadWidth/2+poleCurve, 0, poleHeight, 0, 0, 0, "pole_"+std::to_string(poleIndex)+"lframe");
-		viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_REPRESENTATION, pcl::visualization::PCL_VISUALIZER_REPRESENTATION_WIREFRAME, "pole_"+std::to_string(poleIndex)+"lframe");
+		scene.box("pole_"+std::to_string(poleIndex)+"l", Eigen::Vector3f(markerPos, roadWidth/2+poleCurve, poleHeight/2), Eigen::Quaternionf::Identity(), poleSize, Color(1, 0.5, 0));
 
 		//	right pole
-		viewer->addCube(-poleWidth/2+markerPos, poleWidth/2+markerPos, -poleWidth/2-roadWidth/2-poleCurve, poleWidth/2-roadWidth/2-poleCurve, 0, poleHeight, 1, 0.5, 0, "pole_"+std::to_string(poleIndex)+"r");
-		viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_REPRESENTATION, pcl::visualization::PCL_VISUALIZER_REPRESENTATION_SURFACE, "pole_"+std::to_string(poleIndex)+"r");
-		viewer->addCube(-poleWidth/2+markerPos, poleWidth/2+markerPos, -poleWidth/2-roadWidth/2-poleCurve, poleWidth/2-roadWidth/2-poleCurve, 0, poleHeight, 0, 0, 0, "pole_"+std::to_string(poleIndex)+"rframe");
-		viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_REPRESENTATION, pcl::visualization::PCL_VISUALIZER_REPRESENTATION_WIREFRAME, "pole_"+std::to_string(poleIndex)+"rframe");
+		scene.box("pole_"+std::to_string(poleIndex)+"r", Eigen::Vector3f(markerPos, -roadWidth/2-poleCurve, poleHeight/2), Eigen::Quaternionf::Identity(), poleSize, Color(1, 0.5, 0));
 
 		markerPos+=poleSpace;
 		poleIndex++;
@@ -52,6 +46,19 @@ void renderHighway(double distancePos, pcl::visualization::PCLVisualizer::Ptr& v
 
 }
 
+void renderCar(RenderScene& scene, const Car& car)
+{
+	const Vect3& position = car.position;
+	const Vect3& dimensions = car.dimensions;
+	Color color = car.color;
+
+	// render bottom of car
+	scene.box(car.name, Eigen::Vector3f(position.x, position.y, dimensions.z*1/3), car.orientation, Eigen::Vector3f(dimensions.x, dimensions.y, dimensions.z*2/3), color);
+
+	// render top of car
+	scene.box(car.name + "Top", Eigen::Vector3f(position.x, position.y, dimensions.z*5/6), car.orientation, Eigen::Vector3f(dimensions.x/2, dimensions.y, dimensions.z*1/3), color);
+}
+
 int countRays = 0;
 void renderRays(pcl::visualization::PCLVisualizer::Ptr& viewer, const Vect3& origin, const pcl::PointCloud<pcl::PointXYZ>::Ptr& cloud)
 {
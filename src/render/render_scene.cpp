@@ -0,0 +1,175 @@
+#include "render_scene.h"
+#include <vector>
+
+static bool sameColor(const Color& a, const Color& b)
+{
+	return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+RenderScene::RenderScene(pcl::visualization::PCLVisualizer::Ptr& viewer)
+	: viewer(viewer)
+{}
+
+void RenderScene::beginFrame()
+{
+	for (std::pair<const std::string, Actor>& entry : actors)
+		entry.second.drawn = false;
+}
+
+void RenderScene::endFrame()
+{
+	std::vector<std::string> gone;
+	for (const std::pair<const std::string, Actor>& entry : actors)
+	{
+		if (!entry.second.drawn)
+		{
+			remove(entry.first, entry.second);
+			gone.push_back(entry.first);
+		}
+	}
+	for (const std::string& id : gone)
+		actors.erase(id);
+}
+
+RenderScene::Actor* RenderScene::find(const std::string& id)
+{
+	std::unordered_map<std::string, Actor>::iterator it = actors.find(id);
+	if (it == actors.end())
+		return nullptr;
+	it->second.drawn = true;
+	return &it->second;
+}
+
+void RenderScene::recolor(const std::string& id, Actor& actor, Color color)
+{
+	if (sameColor(actor.color, color))
+		return;
+	viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_COLOR, color.r, color.g, color.b, id);
+	actor.color = color;
+}
+
+void RenderScene::remove(const std::string& id, const Actor& actor)
+{
+	if (actor.kind == CLOUD)
+	{
+		viewer->removePointCloud(id);
+		return;
+	}
+	viewer->removeShape(id);
+	if (actor.kind == BOX)
+		viewer->removeShape(id + "frame");
+}
+
+void RenderScene::box(const std::string& id, const Eigen::Vector3f& center, const Eigen::Quaternionf& rotation, const Eigen::Vector3f& size, Color color, bool outline)
+{
+	Actor* actor = find(id);
+	if (!actor)
+	{
+		viewer->addCube(Eigen::Vector3f::Zero(), Eigen::Quaternionf::Identity(), 1, 1, 1, id);
+		viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_COLOR, color.r, color.g, color.b, id);
+		viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_REPRESENTATION, pcl::visualization::PCL_VISUALIZER_REPRESENTATION_SURFACE, id);
+		if (outline)
+		{
+			viewer->addCube(Eigen::Vector3f::Zero(), Eigen::Quaternionf::Identity(), 1, 1, 1, id + "frame");
+			viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_COLOR, 0, 0, 0, id + "frame");
+			viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_REPRESENTATION, pcl::visualization::PCL_VISUALIZER_REPRESENTATION_WIREFRAME, id + "frame");
+		}
+		actor = &actors.insert(std::make_pair(id, Actor(BOX, color))).first->second;
+	}
+	else
+		recolor(id, *actor, color);
+
+	Eigen::Affine3f pose = Eigen::Translation3f(center) * rotation * Eigen::Scaling(size);
+	viewer->updateShapePose(id, pose);
+	if (outline)
+		viewer->updateShapePose(id + "frame", pose);
+}
+
+void RenderScene::sphere(const std::string& id, const Eigen::Vector3f& center, double radius, Color color, double opacity)
+{
+	pcl::PointXYZ point(center.x(), center.y(), center.z());
+	Actor* actor = find(id);
+	if (!actor)
+	{
+		viewer->addSphere(point, radius, color.r, color.g, color.b, id);
+		actor = &actors.insert(std::make_pair(id, Actor(SPHERE, color))).first->second;
+	}
+	else if (actor->center != center || actor->radius != radius || !sameColor(actor->color, color))
+		viewer->updateSphere(point, radius, color.r, color.g, color.b, id);
+	actor->center = center;
+	actor->radius = radius;
+	actor->color = color;
+
+	if (actor->opacity != opacity)
+	{
+		viewer->setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_OPACITY, opacity, id);
+		actor->opacity = opacity;
+	}
+}
+
+void RenderScene::line(const std::string& id, const Eigen::Vector3f& from, const Eigen::Vector3f& to, Color color)
+{
+	Actor* actor = find(id);
+	if (!actor)
+	{
+		// unit segment along x, stretched and turned onto from-to by its pose
+		viewer->addLine(pcl::PointXYZ(0, 0, 0), pcl::PointXYZ(1, 0, 0), color.r, color.g, color.b, id);
+		actor = &actors.insert(std::make_pair(id, Actor(LINE, color))).first->second;
+	}
+	else
+		recolor(id, *actor, color);
+
+	Eigen::Vector3f direction = to - from;
+	Eigen::Quaternionf rotation = Eigen::Quaternionf::Identity();
+	if (direction.norm() > 1e-6f)
+		rotation = Eigen::Quaternionf::FromTwoVectors(Eigen::Vector3f::UnitX(), direction);
+	Eigen::Affine3f pose = Eigen::Translation3f(from) * rotation * Eigen::Scaling(direction.norm(), 1.0f, 1.0f);
+	viewer->updateShapePose(id, pose);
+}
+
+void RenderScene::arrow(const std::string& id, const Eigen::Vector3f& from, const Eigen::Vector3f& to, Color color)
+{
+	if (find(id))
+		viewer->removeShape(id);
+	else
+		actors.insert(std::make_pair(id, Actor(ARROW, color)));
+	viewer->addArrow(pcl::PointXYZ(from.x(), from.y(), from.z()), pcl::PointXYZ(to.x(), to.y(), to.z()), color.r, color.g, color.b, id);
+}
+
+void RenderScene::text(const std::string& id, const std::string& text, int x, int y, int fontSize, Color color)
+{
+	Actor* actor = find(id);
+	if (!actor)
+	{
+		viewer->addText(text, x, y, fontSize, color.r, color.g, color.b, id);
+		actor = &actors.insert(std::make_pair(id, Actor(TEXT, color))).first->second;
+	}
+	else if (actor->text != text || actor->x != x || actor->y != y || !sameColor(actor->color, color))
+		viewer->updateText(text, x, y, fontSize, color.r, color.g, color.b, id);
+	actor->text = text;
+	actor->x = x;
+	actor->y = y;
+	actor->color = color;
+}
+
+void RenderScene::cloud(const std::string& id, const pcl::PointCloud<pcl::PointXYZ>::Ptr& cloud, Color color, int pointSize)
+{
+	Actor* actor = find(id);
+	if (actor && actor->cloud == cloud.get() && actor->stamp == cloud->header.stamp &&
+		actor->points == cloud->points.size() && sameColor(actor->color, color))
+		return;
+
+	pcl::visualization::PointCloudColorHandlerCustom<pcl::PointXYZ> handler(cloud, color.r * 255, color.g * 255, color.b * 255);
+	if (!actor)
+	{
+		viewer->addPointCloud<pcl::PointXYZ>(cloud, handler, id);
+		viewer->setPointCloudRenderingProperties(pcl::visualization::PCL_VISUALIZER_POINT_SIZE, pointSize, id);
+		actor = &actors.insert(std::make_pair(id, Actor(CLOUD, color))).first->second;
+	}
+	else
+		viewer->updatePointCloud<pcl::PointXYZ>(cloud, handler, id);
+	actor->cloud = cloud.get();
+	actor->stamp = cloud->header.stamp;
+	actor->points = cloud->points.size();
+	actor->color = color;
+}
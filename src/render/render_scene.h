@@ -0,0 +1,76 @@
+// Retained mode drawing on top of the PCL viewer
+
+#ifndef RENDER_SCENE_H
+#define RENDER_SCENE_H
+#include <pcl/visualization/pcl_visualizer.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "../car.h"
+
+/**
+ * Keeps one viewer actor per drawn object across frames.
+ *
+ * Every frame is drawn between beginFrame() and endFrame() by calling the
+ * primitives below with a stable id. The first time an id is drawn its actor
+ * is created; later frames only move it, and only touch color, opacity or
+ * text when they changed. Spheres and clouds, which PCL can only rebuild,
+ * are left alone while they are drawn the same. Actors whose id was not drawn in a frame are
+ * removed by endFrame(). Shapes are created at unit size around the origin
+ * and placed through their pose, so the geometry itself is never rebuilt.
+ */
+class RenderScene
+{
+public:
+	explicit RenderScene(pcl::visualization::PCLVisualizer::Ptr& viewer);
+
+	void beginFrame();
+	void endFrame();
+
+	// solid box, with a black wireframe outline if outline is set
+	void box(const std::string& id, const Eigen::Vector3f& center, const Eigen::Quaternionf& rotation, const Eigen::Vector3f& size, Color color, bool outline = true);
+	void sphere(const std::string& id, const Eigen::Vector3f& center, double radius, Color color, double opacity = 1.0);
+	void line(const std::string& id, const Eigen::Vector3f& from, const Eigen::Vector3f& to, Color color);
+	// PCL arrows are 2D overlay actors without a pose, these are recreated
+	void arrow(const std::string& id, const Eigen::Vector3f& from, const Eigen::Vector3f& to, Color color);
+	void text(const std::string& id, const std::string& text, int x, int y, int fontSize, Color color);
+	// a cloud refilled in place must change its header stamp to be redrawn
+	void cloud(const std::string& id, const pcl::PointCloud<pcl::PointXYZ>::Ptr& cloud, Color color, int pointSize = 4);
+
+	int actorCount() const { return actors.size(); }
+
+private:
+	enum Kind { BOX, SPHERE, LINE, ARROW, TEXT, CLOUD };
+
+	struct Actor
+	{
+		Kind kind;
+		bool drawn;
+		Color color;
+		double opacity;
+		std::string text;
+		int x, y;
+		// what a sphere or cloud was last drawn from
+		Eigen::Vector3f center;
+		double radius;
+		const pcl::PointCloud<pcl::PointXYZ>* cloud;
+		uint64_t stamp;
+		size_t points;
+
+		Actor(Kind setKind, Color setColor)
+			: kind(setKind), drawn(true), color(setColor), opacity(1.0), x(0), y(0),
+			  center(Eigen::Vector3f::Zero()), radius(0), cloud(nullptr), stamp(0), points(0)
+		{}
+	};
+
+	// the actor for id, nullptr if it is new; marks it drawn this frame
+	Actor* find(const std::string& id);
+	// updates the shape color if it changed
+	void recolor(const std::string& id, Actor& actor, Color color);
+	void remove(const std::string& id, const Actor& actor);
+
+	pcl::visualization::PCLVisualizer::Ptr viewer;
+	std::unordered_map<std::string, Actor> actors;
+};
+
+#endif /* RENDER_SCENE_H */
@@ -0,0 +1,98 @@
+#include "rmse_accumulator.h"
+
+RmseAccumulator::RmseAccumulator(int window, bool keepHistory)
+	: window(window > 0 ? window : 0), keepHistory(keepHistory)
+{}
+
+void RmseAccumulator::add(int track, const Vector4d& estimate, const Vector4d& truth)
+{
+	Residual squared = (estimate - truth).array().square().matrix();
+
+	all.add(squared, window);
+	if (track >= (int)tracks.size())
+		tracks.resize(track + 1);
+	tracks[track].add(squared, window);
+
+	if (keepHistory)
+	{
+		estimationHistory.push_back(estimate);
+		truthHistory.push_back(truth);
+	}
+}
+
+void RmseAccumulator::reset()
+{
+	all = Sums();
+	tracks.clear();
+	estimationHistory.clear();
+	truthHistory.clear();
+}
+
+long RmseAccumulator::count(int track) const
+{
+	return track < (int)tracks.size() ? tracks[track].count : 0;
+}
+
+RmseAccumulator::Vector4d RmseAccumulator::rmse() const
+{
+	return all.rmse();
+}
+
+RmseAccumulator::Vector4d RmseAccumulator::rmse(int track) const
+{
+	return track < (int)tracks.size() ? tracks[track].rmse() : Vector4d::Zero();
+}
+
+RmseAccumulator::Vector4d RmseAccumulator::windowRmse() const
+{
+	return window ? all.windowRmse() : all.rmse();
+}
+
+RmseAccumulator::Vector4d RmseAccumulator::windowRmse(int track) const
+{
+	if (track >= (int)tracks.size())
+		return Vector4d::Zero();
+	return window ? tracks[track].windowRmse() : tracks[track].rmse();
+}
+
+void RmseAccumulator::Sums::add(const Residual& squared, int window)
+{
+	total += squared;
+	count++;
+	if (!window)
+		return;
+
+	if ((int)ring.size() < window)
+	{
+		if (ring.empty())
+			ring.reserve(window);
+		ring.push_back(squared);
+		windowTotal += squared;
+		return;
+	}
+
+	windowTotal += squared - ring[head];
+	ring[head] = squared;
+	head = (head + 1) % window;
+	// resum once per lap so the running difference cannot drift
+	if (head == 0)
+	{
+		windowTotal.setZero();
+		for (const Residual& r : ring)
+			windowTotal += r;
+	}
+}
+
+RmseAccumulator::Vector4d RmseAccumulator::Sums::rmse() const
+{
+	if (count == 0)
+		return Vector4d::Zero();
+	return (total / count).cwiseSqrt();
+}
+
+RmseAccumulator::Vector4d RmseAccumulator::Sums::windowRmse() const
+{
+	if (ring.empty())
+		return Vector4d::Zero();
+	return (windowTotal / ring.size()).cwiseSqrt();
+}
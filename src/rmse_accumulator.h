@@ -0,0 +1,68 @@
+#ifndef RMSE_ACCUMULATOR_H_
+#define RMSE_ACCUMULATOR_H_
+#include <vector>
+#include "Eigen/Dense"
+
+/**
+ * Streaming RMSE of [p_x p_y v_x v_y] estimates against ground truth.
+ *
+ * Every sample updates running sums of squared residuals in O(1), overall
+ * and for its track, and, if a window is set, a ring of the last `window`
+ * squared residuals so the RMSE over recent samples is O(1) to read as well.
+ * The samples themselves are only kept when keepHistory is set, so long runs
+ * use constant memory.
+ */
+class RmseAccumulator
+{
+public:
+	typedef Eigen::Vector4d Vector4d;
+
+	// window = 0 tracks the cumulative RMSE only
+	explicit RmseAccumulator(int window = 0, bool keepHistory = false);
+
+	void add(int track, const Vector4d& estimate, const Vector4d& truth);
+	// forget every sample, keeping the window and history settings
+	void reset();
+
+	long count() const { return all.count; }
+	long count(int track) const;
+
+	// RMSE over all samples, zero if there are none
+	Vector4d rmse() const;
+	Vector4d rmse(int track) const;
+	// RMSE over the last `window` samples, cumulative if no window is set
+	Vector4d windowRmse() const;
+	Vector4d windowRmse(int track) const;
+
+	// every sample in order, empty unless keepHistory was set
+	const std::vector<Eigen::VectorXd>& estimations() const { return estimationHistory; }
+	const std::vector<Eigen::VectorXd>& groundTruth() const { return truthHistory; }
+
+private:
+	// unaligned so sums can live in a std::vector
+	typedef Eigen::Matrix<double, 4, 1, Eigen::DontAlign> Residual;
+
+	struct Sums
+	{
+		Residual total;
+		long count;
+		// last window squared residuals, oldest at head once full
+		std::vector<Residual> ring;
+		Residual windowTotal;
+		int head;
+
+		Sums() : total(Residual::Zero()), count(0), windowTotal(Residual::Zero()), head(0) {}
+		void add(const Residual& squared, int window);
+		Vector4d rmse() const;
+		Vector4d windowRmse() const;
+	};
+
+	int window;
+	bool keepHistory;
+	Sums all;
+	std::vector<Sums> tracks;
+	std::vector<Eigen::VectorXd> estimationHistory;
+	std::vector<Eigen::VectorXd> truthHistory;
+};
+
+#endif /* RMSE_ACCUMULATOR_H_ */
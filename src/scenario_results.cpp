@@ -0,0 +1,100 @@
+#include "scenario_results.h"
+
+namespace {
+
+void writeArray(std::ostream& out, const Eigen::Vector4d& v)
+{
+	out << "[" << v[0] << "," << v[1] << "," << v[2] << "," << v[3] << "]";
+}
+
+}
+
+bool ScenarioResults::open(const std::string& file)
+{
+	std::string ext = ".json";
+	format = file.size() >= ext.size() && file.compare(file.size() - ext.size(), ext.size(), ext) == 0 ? JSON : CSV;
+	out.open(file);
+	if(!out)
+		return false;
+	out.precision(9);
+	firstScenario = true;
+	if(format == CSV)
+		out << "seed,timestamp_us,track,est_px,est_py,est_vx,est_vy,gt_px,gt_py,gt_vx,gt_vy,nis_laser,nis_radar,step_ns\n";
+	else
+		out << "{\"scenarios\":[";
+	return true;
+}
+
+bool ScenarioResults::close()
+{
+	if(!out.is_open())
+		return false;
+	if(format == JSON)
+		out << "]}\n";
+	out.close();
+	return !out.fail();
+}
+
+void ScenarioResults::beginScenario(uint64_t setSeed)
+{
+	seed = setSeed;
+	firstFrame = true;
+	if(format == JSON)
+	{
+		if(!firstScenario)
+			out << ",";
+		out << "\n{\"seed\":" << seed << ",\"frames\":[";
+	}
+	firstScenario = false;
+}
+
+void ScenarioResults::frame(const HighwaySim& sim, long long timestamp, long long stepNs)
+{
+	if(format == CSV)
+	{
+		for(int i = 0; i < (int)sim.traffic.size(); i++)
+		{
+			if(!sim.trackCars[i])
+				continue;
+			Eigen::Vector4d estimate = sim.estimate(i);
+			Eigen::Vector4d truth = sim.truth(i);
+			out << seed << "," << timestamp << "," << i;
+			for(int k = 0; k < 4; k++)
+				out << "," << estimate[k];
+			for(int k = 0; k < 4; k++)
+				out << "," << truth[k];
+			out << "," << sim.nisLaser(i) << "," << sim.nisRadar(i) << "," << stepNs << "\n";
+		}
+		return;
+	}
+
+	if(!firstFrame)
+		out << ",";
+	firstFrame = false;
+	out << "\n{\"timestamp_us\":" << timestamp << ",\"step_ns\":" << stepNs << ",\"tracks\":[";
+	bool firstTrack = true;
+	for(int i = 0; i < (int)sim.traffic.size(); i++)
+	{
+		if(!sim.trackCars[i])
+			continue;
+		if(!firstTrack)
+			out << ",";
+		firstTrack = false;
+		out << "{\"track\":" << i << ",\"estimate\":";
+		writeArray(out, sim.estimate(i));
+		out << ",\"truth\":";
+		writeArray(out, sim.truth(i));
+		out << ",\"nis_laser\":" << sim.nisLaser(i) << ",\"nis_radar\":" << sim.nisRadar(i) << "}";
+	}
+	out << "]}";
+}
+
+void ScenarioResults::endScenario(const HighwaySim& sim)
+{
+	if(format == CSV)
+		return;
+	Eigen::Vector4d rmse = sim.rmse;
+	out << "],\n\"rmse\":";
+	writeArray(out, rmse);
+	out << ",\"pass\":" << (sim.pass ? "true" : "false") << "}";
+}
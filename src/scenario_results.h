@@ -0,0 +1,44 @@
+#ifndef SCENARIO_RESULTS_H
+#define SCENARIO_RESULTS_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "highway_sim.h"
+
+/**
+ * Streams the per-frame results of batch scenario runs to a file: for every
+ * tracked car its estimate, ground truth and latest laser and radar NIS, and
+ * the wall time of the frame's step.
+ *
+ * CSV has one row per tracked car and frame, tagged with the scenario seed.
+ * JSON has one object per scenario holding its frames and its final RMSE and
+ * threshold result. Rows are written as they come, so memory does not grow
+ * with the number of scenarios.
+ */
+class ScenarioResults
+{
+public:
+	enum Format
+	{
+		CSV,
+		JSON
+	};
+
+	// the format follows the extension, .json for JSON and CSV otherwise
+	bool open(const std::string& file);
+	bool close();
+
+	void beginScenario(uint64_t seed);
+	void frame(const HighwaySim& sim, long long timestamp, long long stepNs);
+	void endScenario(const HighwaySim& sim);
+
+private:
+	Format format = CSV;
+	std::ofstream out;
+	uint64_t seed = 0;
+	bool firstScenario = true;
+	bool firstFrame = true;
+};
+
+#endif /* SCENARIO_RESULTS_H */
@@ -0,0 +1,112 @@
+#include <iostream>
+#include "sensor_sim.h"
+
+using namespace std;
+using std::vector;
+
+SensorSim::SensorSim() {}
+
+SensorSim::~SensorSim() {}
+
+void SensorSim::drawNoise(long long timestamp, int tracks)
+{
+	frameNoise.resize(tracks * NOISE_CHANNELS);
+	noiseSource.batch(timestamp, tracks, frameNoise.data());
+	frameNoiseTime = timestamp;
+}
+
+double SensorSim::noise(double stddev, long long timestamp, int track, int channel) const
+{
+	size_t i = (size_t)track * NOISE_CHANNELS + channel;
+	if(timestamp == frameNoiseTime && i < frameNoise.size())
+		return stddev * frameNoise[i];
+	return stddev * noiseSource.sample(timestamp, track, channel);
+}
+
+// sense where a car is located using lidar measurement
+lmarker SensorSim::lidarSense(Car& car, long long timestamp, int track)
+{
+	MeasurementPackage meas_package;
+	lmarker marker(0, 0);
+	{
+		UKF_TRACE_SCOPE("lidar_sense");
+		meas_package.sensor_type_ = MeasurementPackage::LASER;
+		meas_package.raw_measurements_ = VectorXd(2);
+
+		marker = lmarker(car.position.x + noise(0.15,timestamp,track,LIDAR_X), car.position.y + noise(0.15,timestamp,track,LIDAR_Y));
+
+		meas_package.raw_measurements_ << marker.x, marker.y;
+		meas_package.timestamp_ = timestamp;
+	}
+    process(car, meas_package);
+
+    return marker;
+}
+
+// sense where a car is located using radar measurement
+rmarker SensorSim::radarSense(Car& car, const Car& ego, long long timestamp, int track)
+{
+	MeasurementPackage meas_package;
+	rmarker marker(0, 0, 0);
+	{
+		UKF_TRACE_SCOPE("radar_sense");
+		double rho = sqrt((car.position.x-ego.position.x)*(car.position.x-ego.position.x)+(car.position.y-ego.position.y)*(car.position.y-ego.position.y));
+		double phi = atan2(car.position.y-ego.position.y,car.position.x-ego.position.x);
+		double rho_dot = (car.velocity*cos(car.angle)*rho*cos(phi) + car.velocity*sin(car.angle)*rho*sin(phi))/rho;
+
+		marker = rmarker(rho+noise(0.3,timestamp,track,RADAR_RHO), phi+noise(0.03,timestamp,track,RADAR_PHI), rho_dot+noise(0.3,timestamp,track,RADAR_RHO_DOT));
+
+		meas_package.sensor_type_ = MeasurementPackage::RADAR;
+		meas_package.raw_measurements_ = VectorXd(3);
+		meas_package.raw_measurements_ << marker.rho, marker.phi, marker.rho_dot;
+		meas_package.timestamp_ = timestamp;
+	}
+    process(car, meas_package);
+
+    return marker;
+}
+
+void SensorSim::process(Car& car, const MeasurementPackage& meas_package)
+{
+	if(!feedFilters)
+		return;
+	if(scheduler)
+		scheduler->enqueue(car.ukf, meas_package);
+	else
+		car.ukf.ProcessMeasurement(meas_package);
+}
+
+VectorXd SensorSim::CalculateRMSE(const vector<VectorXd> &estimations,
+                              const vector<VectorXd> &ground_truth) {
+  
+    VectorXd rmse(4);
+	rmse << 0,0,0,0;
+
+	// check the validity of the following inputs:
+	//  * the estimation vector size should not be zero
+	//  * the estimation vector size should equal ground truth vector size
+	if(estimations.size() != ground_truth.size()
+			|| estimations.size() == 0){
+		cout << "Invalid estimation or ground_truth data" << endl;
+		return rmse;
+	}
+
+	//accumulate squared residuals
+	for(unsigned int i=0; i < estimations.size(); ++i){
+
+		VectorXd residual = estimations[i] - ground_truth[i];
+
+		//coefficient-wise multiplication
+		residual = residual.array()*residual.array();
+		rmse += residual;
+	}
+
+	//calculate the mean
+	rmse = rmse/estimations.size();
+
+	//calculate the squared root
+	rmse = rmse.array().sqrt();
+
+	//return the result
+	return rmse;
+}
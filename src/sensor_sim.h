@@ -0,0 +1,103 @@
+#ifndef SENSOR_SIM_H_
+#define SENSOR_SIM_H_
+#include <vector>
+#include "Eigen/Dense"
+#include "car.h"
+#include "tracking_scheduler.h"
+#include "rmse_accumulator.h"
+#include "counter_rng.h"
+#include "trace.h"
+
+using Eigen::MatrixXd;
+using Eigen::VectorXd;
+using namespace std;
+
+struct lmarker
+{
+	double x, y;
+	lmarker(double setX, double setY)
+		: x(setX), y(setY)
+	{}
+
+};
+
+struct rmarker
+{
+	double rho, phi, rho_dot;
+	rmarker(double setRho, double setPhi, double setRhoDot)
+		: rho(setRho), phi(setPhi), rho_dot(setRhoDot)
+	{}
+
+};
+
+// measurement noise channels of one tracked car
+enum NoiseChannel { LIDAR_X, LIDAR_Y, RADAR_RHO, RADAR_PHI, RADAR_RHO_DOT, NOISE_CHANNELS };
+
+/**
+ * Gaussian measurement noise that is a pure function of
+ * (seed, timestamp, track, channel). Every timestamp is its own counter-based
+ * stream, so samples need no generator state, can be drawn from any thread
+ * and come out the same in any order.
+ */
+class MeasurementNoise {
+	public:
+	explicit MeasurementNoise(uint64_t seed = 0) : seed_(seed) {}
+
+	// one standard normal sample
+	double sample(long long timestamp, int track, int channel) const
+	{
+		return CounterRng(seed_, timestamp).gaussian((uint64_t)track * NOISE_CHANNELS + channel);
+	}
+
+	// standard normal samples of every channel of tracks 0 .. tracks-1, one
+	// row of NOISE_CHANNELS per track; equal to sample() entry for entry
+	void batch(long long timestamp, int tracks, double* out) const
+	{
+		CounterRng(seed_, timestamp).gaussians(0, tracks * NOISE_CHANNELS, out);
+	}
+
+	private:
+	uint64_t seed_;
+};
+
+/**
+ * Simulated lidar and radar measurements of the tracked cars and the RMSE of
+ * the resulting estimates. Has no rendering dependencies so it can run in the
+ * headless simulation; Tools layers visualization on top.
+ */
+class SensorSim {
+	public:
+	SensorSim();
+	virtual ~SensorSim();
+
+	// Members
+	// running RMSE of the estimates, see RmseAccumulator
+	RmseAccumulator accuracy;
+	// if set, sensed measurements are queued here instead of processed immediately
+	TrackingScheduler* scheduler = nullptr;
+	// if false, sensing only returns the markers and leaves the cars' UKFs alone
+	bool feedFilters = true;
+
+	MeasurementNoise noiseSource;
+
+	// draws the noise of every channel of tracks 0 .. tracks-1 at once;
+	// sensing at this timestamp then reads it instead of sampling per call
+	void drawNoise(long long timestamp, int tracks);
+	double noise(double stddev, long long timestamp, int track, int channel) const;
+	// sense the car and hand the measurement to its UKF, track selects the
+	// car's noise streams
+	lmarker lidarSense(Car& car, long long timestamp, int track = 0);
+	rmarker radarSense(Car& car, const Car& ego, long long timestamp, int track = 0);
+	/**
+	* A helper method to calculate RMSE over a stored history.
+	*/
+	VectorXd CalculateRMSE(const vector<VectorXd> &estimations, const vector<VectorXd> &ground_truth);
+
+	private:
+	std::vector<double> frameNoise;
+	long long frameNoiseTime = -1;
+
+	void process(Car& car, const MeasurementPackage& meas_package);
+};
+
+#endif /* SENSOR_SIM_H_ */
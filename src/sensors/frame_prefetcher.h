@@ -0,0 +1,150 @@
+#ifndef FRAME_PREFETCHER_H
+#define FRAME_PREFETCHER_H
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Loads recorded frames on a background thread ahead of playback.
+ *
+ * The frames of a schedule are read, in order, into a bounded ring of
+ * preallocated slots; the loader stops when the ring is full and resumes as
+ * playback frees slots, so at most slots.size() frames are ever in memory.
+ * get() only blocks when the loader has fallen behind, and counts those
+ * stalls.
+ */
+template <typename Frame>
+class FramePrefetcher
+{
+public:
+	// fills frame with the recording at timestamp, false if it is missing
+	typedef std::function<bool(long long timestamp, Frame& frame)> Loader;
+
+	// one slot per frame that may be loaded ahead, at least two
+	FramePrefetcher(std::vector<Frame> setSlots, Loader setLoad)
+		: slots(setSlots), load(setLoad), ready(slots.size(), false), timestamps(slots.size(), 0),
+		  head(0), count(0), held(false), done(true), stop(false), stallCount(0)
+	{}
+
+	~FramePrefetcher()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		changed.notify_all();
+		if(worker.joinable())
+			worker.join();
+	}
+
+	FramePrefetcher(const FramePrefetcher&) = delete;
+	FramePrefetcher& operator=(const FramePrefetcher&) = delete;
+
+	// timestamps to load, in playback order
+	void start(const std::vector<long long>& schedule)
+	{
+		done = false;
+		worker = std::thread(&FramePrefetcher::loadAll, this, schedule);
+	}
+
+	// frame recorded at timestamp, nullptr if the recording has none; the
+	// frame stays valid until the next call. Frames before timestamp that
+	// were never asked for are skipped.
+	Frame* get(long long timestamp)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if(held)
+			release();
+
+		while(true)
+		{
+			if(count == 0 && !done)
+			{
+				stallCount++;
+				changed.wait(lock, [this]() { return count > 0 || done; });
+			}
+			if(count == 0)
+				return nullptr;
+			if(timestamps[head] > timestamp)
+				return nullptr;
+			if(timestamps[head] == timestamp && ready[head])
+			{
+				held = true;
+				return &slots[head];
+			}
+			release();
+		}
+	}
+
+	// get() calls that had to wait for the loader
+	long stalls() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return stallCount;
+	}
+
+private:
+	// caller holds the lock
+	void release()
+	{
+		head = (head + 1) % slots.size();
+		count--;
+		held = false;
+		changed.notify_all();
+	}
+
+	void loadAll(std::vector<long long> schedule)
+	{
+		for(long long timestamp : schedule)
+		{
+			size_t slot;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				// back-pressure: the slot handed to playback is not free either
+				changed.wait(lock, [this]() { return stop || count < slots.size(); });
+				if(stop)
+					return;
+				slot = (head + count) % slots.size();
+			}
+
+			// slots past head + count are only touched by this thread
+			bool ok = load(timestamp, slots[slot]);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				timestamps[slot] = timestamp;
+				ready[slot] = ok;
+				count++;
+			}
+			changed.notify_all();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done = true;
+		}
+		changed.notify_all();
+	}
+
+	std::vector<Frame> slots;
+	Loader load;
+	std::vector<bool> ready;
+	std::vector<long long> timestamps;
+
+	// filled slots are head .. head + count - 1, the one at head is in use
+	// by playback when held is set
+	size_t head;
+	size_t count;
+	bool held;
+	bool done;
+	bool stop;
+	long stallCount;
+
+	mutable std::mutex mutex;
+	std::condition_variable changed;
+	std::thread worker;
+};
+
+#endif /* FRAME_PREFETCHER_H */
@@ -0,0 +1,116 @@
+#include "frame_store.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+PcdFrameStore::PcdFrameStore()
+	: data(nullptr), bytes(0), index(nullptr), count(0)
+{}
+
+PcdFrameStore::~PcdFrameStore()
+{
+	close();
+}
+
+bool PcdFrameStore::open(const std::string& file)
+{
+	close();
+	int fd = ::open(file.c_str(), O_RDONLY);
+	if(fd < 0)
+	{
+		std::cerr << "Couldn't read file " << file << std::endl;
+		return false;
+	}
+	struct stat info;
+	void* mapping = MAP_FAILED;
+	if(fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(PcdContainerHeader))
+		mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps the file alive
+	::close(fd);
+	if(mapping == MAP_FAILED)
+	{
+		std::cerr << "Couldn't map file " << file << std::endl;
+		return false;
+	}
+	data = static_cast<const unsigned char*>(mapping);
+	bytes = info.st_size;
+
+	PcdContainerHeader header;
+	memcpy(&header, data, sizeof(header));
+	bool valid = memcmp(header.magic, pcdContainerMagic, sizeof(header.magic)) == 0 && header.version == 1 &&
+		header.indexOffset <= bytes && header.frameCount <= (bytes - header.indexOffset) / sizeof(PcdFrameInfo) &&
+		header.indexOffset % alignof(PcdFrameInfo) == 0;
+	if(valid)
+	{
+		index = reinterpret_cast<const PcdFrameInfo*>(data + header.indexOffset);
+		count = header.frameCount;
+		for(size_t i = 0; i < count && valid; i++)
+			valid = pcdFrameFits(index[i], bytes);
+	}
+	if(!valid)
+	{
+		std::cerr << file << " is not a PCD container" << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void PcdFrameStore::close()
+{
+	if(data)
+		munmap(const_cast<unsigned char*>(data), bytes);
+	data = nullptr;
+	bytes = 0;
+	index = nullptr;
+	count = 0;
+}
+
+long PcdFrameStore::find(int64_t timestamp) const
+{
+	long i = seek(timestamp);
+	return (i >= 0 && index[i].timestamp == timestamp) ? i : -1;
+}
+
+long PcdFrameStore::seek(int64_t timestamp) const
+{
+	const PcdFrameInfo* it = std::upper_bound(index, index + count, timestamp,
+		[](int64_t t, const PcdFrameInfo& info) { return t < info.timestamp; });
+	return (it - index) - 1;
+}
+
+bool PcdFrameStore::view(size_t i, PcdFrameView& view, std::vector<float>& scratch) const
+{
+	if(i >= count)
+		return false;
+	const PcdFrameInfo& info = index[i];
+	const unsigned char* stored = data + info.offset;
+	view.timestamp = info.timestamp;
+	view.points = info.points;
+
+	if(info.codec == PCD_RAW && info.storedBytes == (uint64_t)info.points * 3 * sizeof(float))
+	{
+		// blocks are 64 byte aligned in the file and so in the mapping
+		view.xyz = reinterpret_cast<const float*>(stored);
+		return true;
+	}
+
+	static thread_local std::vector<unsigned char> planes;
+	scratch.resize((size_t)info.points * 3);
+	view.xyz = scratch.data();
+	return decodePcdBlock(info, stored, scratch.data(), planes);
+}
+
+void PcdFrameStore::prefetch(size_t i) const
+{
+	if(i >= count)
+		return;
+	// madvise wants a page aligned start
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t start = index[i].offset / page * page;
+	madvise(const_cast<unsigned char*>(data) + start, index[i].offset + index[i].storedBytes - start, MADV_WILLNEED);
+}
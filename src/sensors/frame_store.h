@@ -0,0 +1,58 @@
+#ifndef FRAME_STORE_H
+#define FRAME_STORE_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "pcd_container.h"
+
+// points of one frame, valid while the store is open
+struct PcdFrameView
+{
+	int64_t timestamp;
+	const float* xyz;
+	uint32_t points;
+};
+
+/**
+ * Read-only, memory-mapped view of a PCD container.
+ *
+ * The recording is opened and mapped once; a frame is found by binary search
+ * over the index and raw frames are handed out as pointers into the mapping,
+ * so replay, seeking and random access do no file system calls or copies.
+ * Deflate frames are decoded into a caller buffer instead. All const members
+ * are safe to call from several threads.
+ */
+class PcdFrameStore
+{
+public:
+	PcdFrameStore();
+	~PcdFrameStore();
+
+	PcdFrameStore(const PcdFrameStore&) = delete;
+	PcdFrameStore& operator=(const PcdFrameStore&) = delete;
+
+	bool open(const std::string& file);
+	void close();
+	bool isOpen() const { return data != nullptr; }
+
+	size_t size() const { return count; }
+	const PcdFrameInfo& frame(size_t i) const { return index[i]; }
+	// frame recorded at timestamp, -1 if there is none
+	long find(int64_t timestamp) const;
+	// last frame recorded at or before timestamp, -1 if there is none
+	long seek(int64_t timestamp) const;
+
+	// view of frame i; scratch is only used, and must outlive the view, for
+	// compressed frames
+	bool view(size_t i, PcdFrameView& view, std::vector<float>& scratch) const;
+	// ask the kernel to start paging in frame i
+	void prefetch(size_t i) const;
+
+private:
+	const unsigned char* data;
+	size_t bytes;
+	const PcdFrameInfo* index;
+	size_t count;
+};
+
+#endif /* FRAME_STORE_H */
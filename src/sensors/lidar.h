@@ -2,7 +2,13 @@
 #define LIDAR_H
 #include "../render/render.h"
 #include <ctime>
-#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include "../counter_rng.h"
+#include "../thread_pool.h"
+#include "../trace.h"
+#include "scene.h"
 
 const double pi = 3.1415;
 
@@ -10,7 +16,7 @@ struct Ray
 {
 	
 	Vect3 origin;
-	double resolution;
+	// unit length
 	Vect3 direction;
 	Vect3 castPosition;
 	double castDistance;
@@ -20,43 +26,71 @@ struct Ray
 	// horizontalAngle: the angle of direction the ray travels on the xy plane
 	// verticalAngle: the angle of direction between xy plane and ray 
 	// 				  for example 0 radians is along xy plane and pi/2 radians is stright up
-	// resoultion: the magnitude of the ray's step, used for ray casting, the smaller the more accurate but the more expensive
 
-	Ray(Vect3 setOrigin, double horizontalAngle, double verticalAngle, double setResolution)
-		: origin(setOrigin), resolution(setResolution), direction(resolution*cos(verticalAngle)*cos(horizontalAngle), resolution*cos(verticalAngle)*sin(horizontalAngle),resolution*sin(verticalAngle)),
+	Ray(Vect3 setOrigin, double horizontalAngle, double verticalAngle)
+		: origin(setOrigin), direction(cos(verticalAngle)*cos(horizontalAngle), cos(verticalAngle)*sin(horizontalAngle), sin(verticalAngle)),
 		  castPosition(origin), castDistance(0)
 	{}
 
-	void rayCast(const std::vector<Car>& cars, double minDistance, double maxDistance, pcl::PointCloud<pcl::PointXYZ>::Ptr& cloud, double slopeAngle, double sderr)
+	// the ray stays inside the highway, x in [-15, 50] and y in [-6, 6]
+	double exitDistance() const
 	{
-		// reset ray
-		castPosition = origin;
-		castDistance = 0;
+		double tx = std::numeric_limits<double>::infinity();
+		double ty = std::numeric_limits<double>::infinity();
+		if(direction.x > 0)
+			tx = (50 - origin.x) / direction.x;
+		else if(direction.x < 0)
+			tx = (-15 - origin.x) / direction.x;
+		if(direction.y > 0)
+			ty = (6 - origin.y) / direction.y;
+		else if(direction.y < 0)
+			ty = (-6 - origin.y) / direction.y;
+		return std::min(tx, ty);
+	}
 
-		bool collision = false;
+	// distance to the ground z = x tan(slopeAngle), or infinity if the ray
+	// never reaches it
+	double groundDistance(double slopeAngle) const
+	{
+		double slope = tan(slopeAngle);
+		double towardsGround = direction.z - direction.x * slope;
+		if(towardsGround < 0)
+			return std::max(0.0, (origin.x * slope - origin.z) / towardsGround);
+		return std::numeric_limits<double>::infinity();
+	}
 
-		while(!collision && castDistance < maxDistance && (castPosition.y <= 6 && castPosition.y >= -6 && castPosition.x <= 50 && castPosition.x >= -15))
-		{
+	// intersects the ray in closed form with the ground slope and with the
+	// two boxes of every car; on a hit inside the highway and the range
+	// limits, castPosition is the nearest hit and true is returned
+	bool cast(const std::vector<Car>& cars, double minDistance, double maxDistance, double slopeAngle)
+	{
+		double hit = groundDistance(slopeAngle);
+		for(const Car& car : cars)
+			hit = std::min(hit, car.intersect(origin, direction));
+		return accept(hit, minDistance, maxDistance);
+	}
 
-			castPosition = castPosition + direction;
-			castDistance += resolution;
+	// same, only testing the scene objects along the ray
+	bool cast(const LidarScene& scene, double minDistance, double maxDistance, double slopeAngle)
+	{
+		double hit = groundDistance(slopeAngle);
+		double limit = std::min(hit, std::min(exitDistance(), maxDistance));
+		hit = std::min(hit, scene.intersect(origin, direction, limit));
+		return accept(hit, minDistance, maxDistance);
+	}
 
-			// check if there is any collisions with ground slope
-			collision = (castPosition.z <= castPosition.x * tan(slopeAngle));
+	bool accept(double hit, double minDistance, double maxDistance)
+	{
+		double exit = exitDistance();
+		castDistance = std::min(hit, std::min(exit, maxDistance));
+		castPosition = Vect3(origin.x + castDistance * direction.x, origin.y + castDistance * direction.y, origin.z + castDistance * direction.z);
 
-			// check if there is any collisions with cars
-			if(!collision && castDistance < maxDistance)
-			{
-				for(Car car : cars)
-				{
-					collision |= car.checkCollision(castPosition);
-					if(collision)
-						break;
-				}
-			}
-		}
+		return hit <= exit && hit >= minDistance && hit <= maxDistance;
+	}
 
-		if((castDistance >= minDistance)&&(castDistance<=maxDistance)&& (castPosition.y <= 6 && castPosition.y >= -6 && castPosition.x <= 50 && castPosition.x >= -15))
+	void rayCast(const std::vector<Car>& cars, double minDistance, double maxDistance, pcl::PointCloud<pcl::PointXYZ>::Ptr& cloud, double slopeAngle, double sderr)
+	{
+		if(cast(cars, minDistance, maxDistance, slopeAngle))
 		{
 			// add noise based on standard deviation error
 			double rx = ((double) rand() / (RAND_MAX));
@@ -79,16 +113,29 @@ struct Lidar
 	double groundSlope;
 	double minDistance;
 	double maxDistance;
-	double resoultion;
 	double sderr;
-
-	Lidar(std::vector<Car> setCars, double setGroundSlope)
-		: cloud(new pcl::PointCloud<pcl::PointXYZ>()), position(0,0,3.0)
+	// noise streams are keyed by seed, scan number and tile
+	uint64_t seed;
+	uint64_t scanCount;
+	// distance the ego car has travelled, shifts the poles like renderHighway,
+	// set by Highway every frame
+	double distancePos;
+	LidarScene scene;
+
+	// rays per tile, fixed so the cloud does not depend on the thread count
+	static const int tileSize = 2048;
+	// started by the first scan, a Lidar that never scans runs no threads
+	unsigned poolThreads;
+	std::unique_ptr<ThreadPool> pool;
+	std::vector<std::vector<pcl::PointXYZ> > tiles;
+
+	// threads = 0 uses one worker per hardware thread
+	Lidar(std::vector<Car> setCars, double setGroundSlope, unsigned threads = 0)
+		: cloud(new pcl::PointCloud<pcl::PointXYZ>()), position(0,0,3.0), seed(0), scanCount(0), distancePos(0), poolThreads(threads)
 	{
 		// TODO:: set minDistance to 5 to remove points from roof of ego car
 		minDistance = 0;
 		maxDistance = 120;
-		resoultion = 0.2;
 		// TODO:: set sderr to 0.2 to get more interesting pcd files
 		sderr = 0.02;
 		cars = setCars;
@@ -108,10 +155,11 @@ struct Lidar
 		{
 			for(double angle = 0; angle <= 2*pi; angle+=horizontalAngleInc)
 			{
-				Ray ray(position,angle,angleVertical,resoultion);
+				Ray ray(position,angle,angleVertical);
 				rays.push_back(ray);
 			}
 		}
+		tiles.resize((rays.size() + tileSize - 1) / tileSize);
 	}
 
 	~Lidar()
@@ -124,16 +172,52 @@ struct Lidar
 		cars = setCars;
 	}
 
+	// casts the rays tile by tile on the pool; every tile adds noise from its
+	// own stream into its own buffer and the buffers are joined in tile order,
+	// so a scan is reproducible for a given seed regardless of scheduling
 	pcl::PointCloud<pcl::PointXYZ>::Ptr scan()
 	{
- 
-		cloud->points.clear();
-		auto startTime = std::chrono::steady_clock::now();
-		for(Ray ray : rays)
-			ray.rayCast(cars, minDistance, maxDistance, cloud, groundSlope, sderr);
-		auto endTime = std::chrono::steady_clock::now();
-		auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
-		cout << "ray casting took " << elapsedTime.count() << " milliseconds" << endl;
+		// timed by the trace scope, a scan does not print
+		UKF_TRACE_SCOPE("lidar_scan");
+		scene.clear();
+		for(const Car& car : cars)
+			scene.addCar(car);
+		scene.addHighwayPoles(distancePos);
+		scene.build();
+
+		uint64_t scanIndex = scanCount++;
+		if(!pool)
+			pool.reset(new ThreadPool(poolThreads));
+		pool->parallelFor(tiles.size(), [this, scanIndex](int t) {
+			std::vector<pcl::PointXYZ>& points = tiles[t];
+			points.clear();
+			CounterRng rng(seed, (scanIndex << 32) | t);
+			int end = std::min<int>(rays.size(), (t + 1) * tileSize);
+			for(int r = t * tileSize; r < end; r++)
+			{
+				Ray& ray = rays[r];
+				if(!ray.cast(scene, minDistance, maxDistance, groundSlope))
+					continue;
+				// add noise based on standard deviation error
+				uint64_t counter = 3 * (uint64_t)(r - t * tileSize);
+				double rx = rng.uniform(counter);
+				double ry = rng.uniform(counter + 1);
+				double rz = rng.uniform(counter + 2);
+				points.push_back(pcl::PointXYZ(ray.castPosition.x+rx*sderr, ray.castPosition.y+ry*sderr, ray.castPosition.z+rz*sderr));
+			}
+		});
+
+		size_t total = 0;
+		for(const std::vector<pcl::PointXYZ>& points : tiles)
+			total += points.size();
+		cloud->points.resize(total);
+		size_t offset = 0;
+		for(const std::vector<pcl::PointXYZ>& points : tiles)
+		{
+			std::copy(points.begin(), points.end(), cloud->points.begin() + offset);
+			offset += points.size();
+		}
+
 		cloud->width = cloud->points.size();
 		cloud->height = 1; // one dimensional unorganized point cloud dataset
 		return cloud;
@@ -0,0 +1,413 @@
+#include "pcd_container.h"
+#include <dirent.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#ifdef UKF_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+static const uint64_t blockAlignment = 64;
+// deflate expands at most about 1032:1, a larger point count is corrupt
+static const uint64_t maxDeflateRatio = 1032;
+
+bool pcdFrameFits(const PcdFrameInfo& info, uint64_t fileBytes)
+{
+	uint64_t floatBytes = (uint64_t)info.points * 3 * sizeof(float);
+	if(info.offset > fileBytes || info.storedBytes > fileBytes - info.offset)
+		return false;
+	if(info.codec == PCD_RAW)
+		return info.storedBytes == floatBytes;
+	return floatBytes / maxDeflateRatio <= info.storedBytes;
+}
+
+bool pcdDeflateAvailable()
+{
+#ifdef UKF_HAVE_ZLIB
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool listPcdFrames(const std::string& directory, std::vector<std::pair<long long, std::string> >& frames)
+{
+	DIR* dir = opendir(directory.c_str());
+	if(!dir)
+	{
+		std::cerr << "Couldn't open directory " << directory << std::endl;
+		return false;
+	}
+	frames.clear();
+	while(dirent* entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		size_t underscore = name.rfind('_');
+		if(name.size() < 5 || name.compare(name.size() - 4, 4, ".pcd") != 0 || underscore == std::string::npos)
+			continue;
+		std::string digits = name.substr(underscore + 1, name.size() - 4 - underscore - 1);
+		if(digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos)
+			continue;
+		frames.push_back(std::make_pair(atoll(digits.c_str()), directory + "/" + name));
+	}
+	closedir(dir);
+	std::sort(frames.begin(), frames.end());
+	return true;
+}
+
+bool readPcdXyz(const std::string& file, std::vector<float>& xyz)
+{
+	std::ifstream in(file, std::ios::binary);
+	if(!in)
+	{
+		std::cerr << "Couldn't read file " << file << std::endl;
+		return false;
+	}
+	std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	// header, one "KEY values" line each up to DATA
+	std::vector<std::string> fields;
+	std::vector<int> sizes, counts;
+	std::vector<char> types;
+	size_t points = 0;
+	std::string data;
+	size_t pos = 0;
+	while(pos < contents.size() && data.empty())
+	{
+		size_t end = contents.find('\n', pos);
+		if(end == std::string::npos)
+			end = contents.size();
+		std::istringstream line(contents.substr(pos, end - pos));
+		pos = end + 1;
+
+		std::string key;
+		line >> key;
+		if(key == "FIELDS")
+			for(std::string f; line >> f; ) fields.push_back(f);
+		else if(key == "SIZE")
+			for(int v; line >> v; ) sizes.push_back(v);
+		else if(key == "TYPE")
+			for(char v; line >> v; ) types.push_back(v);
+		else if(key == "COUNT")
+			for(int v; line >> v; ) counts.push_back(v);
+		else if(key == "POINTS")
+			line >> points;
+		else if(key == "DATA")
+			line >> data;
+	}
+	if(counts.empty())
+		counts.assign(fields.size(), 1);
+	if(data.empty() || sizes.size() != fields.size() || types.size() != fields.size() || counts.size() != fields.size())
+	{
+		std::cerr << "Malformed PCD header in " << file << std::endl;
+		return false;
+	}
+
+	// position of x, y and z among the values and bytes of a point
+	int valuesPerPoint = 0, bytesPerPoint = 0;
+	int value[3] = {-1, -1, -1}, byte[3] = {-1, -1, -1};
+	for(size_t f = 0; f < fields.size(); f++)
+	{
+		int axis = fields[f] == "x" ? 0 : fields[f] == "y" ? 1 : fields[f] == "z" ? 2 : -1;
+		if(axis >= 0 && types[f] == 'F' && sizes[f] == 4)
+		{
+			value[axis] = valuesPerPoint;
+			byte[axis] = bytesPerPoint;
+		}
+		valuesPerPoint += counts[f];
+		bytesPerPoint += counts[f] * sizes[f];
+	}
+	if(value[0] < 0 || value[1] < 0 || value[2] < 0)
+	{
+		std::cerr << "No float x y z fields in " << file << std::endl;
+		return false;
+	}
+
+	xyz.resize(points * 3);
+	if(data == "ascii")
+	{
+		const char* p = contents.c_str() + std::min(pos, contents.size());
+		std::vector<float> values(valuesPerPoint);
+		for(size_t i = 0; i < points; i++)
+		{
+			for(int v = 0; v < valuesPerPoint; v++)
+			{
+				char* next;
+				values[v] = strtof(p, &next);
+				if(next == p)
+				{
+					std::cerr << "Truncated point data in " << file << std::endl;
+					return false;
+				}
+				p = next;
+			}
+			for(int axis = 0; axis < 3; axis++)
+				xyz[3 * i + axis] = values[value[axis]];
+		}
+	}
+	else if(data == "binary")
+	{
+		if(pos + points * bytesPerPoint > contents.size())
+		{
+			std::cerr << "Truncated point data in " << file << std::endl;
+			return false;
+		}
+		const char* p = contents.data() + pos;
+		for(size_t i = 0; i < points; i++, p += bytesPerPoint)
+			for(int axis = 0; axis < 3; axis++)
+				memcpy(&xyz[3 * i + axis], p + byte[axis], sizeof(float));
+	}
+	else
+	{
+		std::cerr << "Unsupported PCD data encoding " << data << " in " << file << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Lossless float filter for deflate: the x, y and z coordinates go into
+// separate streams, each value is XORed with the previous one of its stream
+// so the shared sign, exponent and leading mantissa bits cancel, and byte k
+// of every word goes into plane k.
+static void filterPoints(const float* xyz, size_t points, unsigned char* planes)
+{
+	size_t words = points * 3;
+	for(int axis = 0; axis < 3; axis++)
+	{
+		uint32_t previous = 0;
+		for(size_t i = 0; i < points; i++)
+		{
+			uint32_t word;
+			memcpy(&word, &xyz[3 * i + axis], sizeof(word));
+			uint32_t residual = word ^ previous;
+			previous = word;
+			size_t w = axis * points + i;
+			for(int k = 0; k < 4; k++)
+				planes[k * words + w] = residual >> (8 * k);
+		}
+	}
+}
+
+static void unfilterPoints(const unsigned char* planes, size_t points, float* xyz)
+{
+	size_t words = points * 3;
+	for(int axis = 0; axis < 3; axis++)
+	{
+		uint32_t previous = 0;
+		for(size_t i = 0; i < points; i++)
+		{
+			size_t w = axis * points + i;
+			uint32_t residual = 0;
+			for(int k = 0; k < 4; k++)
+				residual |= (uint32_t)planes[k * words + w] << (8 * k);
+			previous ^= residual;
+			memcpy(&xyz[3 * i + axis], &previous, sizeof(previous));
+		}
+	}
+}
+
+bool decodePcdBlock(const PcdFrameInfo& info, const unsigned char* stored, float* xyz, std::vector<unsigned char>& planes)
+{
+	size_t floats = (size_t)info.points * 3;
+	if(info.codec == PCD_RAW)
+	{
+		if(info.storedBytes != floats * sizeof(float))
+			return false;
+		memcpy(xyz, stored, info.storedBytes);
+		return true;
+	}
+#ifdef UKF_HAVE_ZLIB
+	if(info.codec == PCD_DEFLATE)
+	{
+		planes.resize(floats * sizeof(float));
+		uLongf length = planes.size();
+		if(uncompress(planes.data(), &length, stored, info.storedBytes) != Z_OK || length != planes.size())
+			return false;
+		unfilterPoints(planes.data(), info.points, xyz);
+		return true;
+	}
+#endif
+	std::cerr << "Unsupported PCD block codec " << info.codec << std::endl;
+	return false;
+}
+
+PcdContainerWriter::PcdContainerWriter()
+	: out(nullptr), compress(false), offset(0)
+{}
+
+PcdContainerWriter::~PcdContainerWriter()
+{
+	if(out)
+		close();
+}
+
+bool PcdContainerWriter::open(const std::string& file, bool setCompress)
+{
+	out = fopen(file.c_str(), "wb");
+	if(!out)
+	{
+		std::cerr << "Couldn't write file " << file << std::endl;
+		return false;
+	}
+	compress = setCompress && pcdDeflateAvailable();
+	index.clear();
+
+	// placeholder, rewritten with the index position by close()
+	PcdContainerHeader header = {};
+	offset = 0;
+	return writeBlock(&header, sizeof(header));
+}
+
+bool PcdContainerWriter::writeBlock(const void* data, size_t bytes)
+{
+	if(fwrite(data, 1, bytes, out) != bytes)
+		return false;
+	offset += bytes;
+	return true;
+}
+
+bool PcdContainerWriter::pad()
+{
+	static const unsigned char zeros[blockAlignment] = {};
+	return writeBlock(zeros, (blockAlignment - offset % blockAlignment) % blockAlignment);
+}
+
+bool PcdContainerWriter::addFrame(int64_t timestamp, const float* xyz, uint32_t points)
+{
+	if(!out || (!index.empty() && timestamp <= index.back().timestamp))
+		return false;
+
+	if(!pad())
+		return false;
+
+	PcdFrameInfo info;
+	info.timestamp = timestamp;
+	info.offset = offset;
+	info.points = points;
+	info.codec = PCD_RAW;
+
+	size_t floats = (size_t)points * 3;
+	const void* block = xyz;
+	info.storedBytes = floats * sizeof(float);
+#ifdef UKF_HAVE_ZLIB
+	if(compress && points > 0)
+	{
+		planes.resize(floats * sizeof(float));
+		filterPoints(xyz, points, planes.data());
+		packed.resize(compressBound(planes.size()));
+		uLongf length = packed.size();
+		if(compress2(packed.data(), &length, planes.data(), planes.size(), Z_BEST_COMPRESSION) != Z_OK)
+			return false;
+		// keep incompressible frames raw
+		if(length < info.storedBytes)
+		{
+			info.codec = PCD_DEFLATE;
+			info.storedBytes = length;
+			block = packed.data();
+		}
+	}
+#endif
+	if(!writeBlock(block, info.storedBytes))
+		return false;
+	index.push_back(info);
+	return true;
+}
+
+bool PcdContainerWriter::close()
+{
+	if(!out)
+		return false;
+
+	bool ok = pad();
+	PcdContainerHeader header = {};
+	memcpy(header.magic, pcdContainerMagic, sizeof(header.magic));
+	header.version = 1;
+	header.frameCount = index.size();
+	header.indexOffset = offset;
+
+	ok = ok && writeBlock(index.data(), index.size() * sizeof(PcdFrameInfo));
+	ok = ok && fseek(out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, out) == 1;
+	ok = (fclose(out) == 0) && ok;
+	out = nullptr;
+	return ok;
+}
+
+PcdContainerReader::PcdContainerReader()
+	: in(nullptr)
+{}
+
+PcdContainerReader::~PcdContainerReader()
+{
+	close();
+}
+
+bool PcdContainerReader::open(const std::string& file)
+{
+	close();
+	in = fopen(file.c_str(), "rb");
+	if(!in)
+	{
+		std::cerr << "Couldn't read file " << file << std::endl;
+		return false;
+	}
+
+	PcdContainerHeader header;
+	if(fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, pcdContainerMagic, sizeof(header.magic)) != 0 || header.version != 1)
+	{
+		std::cerr << file << " is not a PCD container" << std::endl;
+		close();
+		return false;
+	}
+	// the header and index are checked against the file before anything is
+	// sized from them, as PcdFrameStore does
+	long fileBytes = fseek(in, 0, SEEK_END) == 0 ? ftell(in) : -1;
+	bool valid = fileBytes >= 0 && header.indexOffset <= (uint64_t)fileBytes &&
+		header.frameCount <= ((uint64_t)fileBytes - header.indexOffset) / sizeof(PcdFrameInfo);
+	if(valid)
+	{
+		index.resize(header.frameCount);
+		valid = fseek(in, header.indexOffset, SEEK_SET) == 0 && fread(index.data(), sizeof(PcdFrameInfo), index.size(), in) == index.size();
+		for(size_t i = 0; i < index.size() && valid; i++)
+			valid = pcdFrameFits(index[i], fileBytes);
+	}
+	if(!valid)
+	{
+		std::cerr << "Truncated PCD container " << file << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void PcdContainerReader::close()
+{
+	if(in)
+		fclose(in);
+	in = nullptr;
+	index.clear();
+}
+
+long PcdContainerReader::findFrame(int64_t timestamp) const
+{
+	std::vector<PcdFrameInfo>::const_iterator it = std::lower_bound(index.begin(), index.end(), timestamp,
+		[](const PcdFrameInfo& info, int64_t t) { return info.timestamp < t; });
+	if(it == index.end() || it->timestamp != timestamp)
+		return -1;
+	return it - index.begin();
+}
+
+bool PcdContainerReader::readFrame(size_t i, std::vector<float>& xyz)
+{
+	if(!in || i >= index.size())
+		return false;
+	// open checked the block and point count of every frame against the file
+	const PcdFrameInfo& info = index[i];
+	packed.resize(info.storedBytes);
+	if(fseek(in, info.offset, SEEK_SET) != 0 || fread(packed.data(), 1, packed.size(), in) != packed.size())
+		return false;
+	xyz.resize((size_t)info.points * 3);
+	return decodePcdBlock(info, packed.data(), xyz.data(), planes);
+}
@@ -0,0 +1,114 @@
+#ifndef PCD_CONTAINER_H
+#define PCD_CONTAINER_H
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Binary container for a recorded sequence of xyz point clouds.
+ *
+ * Layout, little endian:
+ *   PcdContainerHeader
+ *   frame blocks, each starting on a 64 byte boundary
+ *   index of PcdFrameInfo, one per frame, sorted by timestamp, also on a
+ *   64 byte boundary
+ * A raw block is the frame's points as float32 x y z triples. A deflate
+ * block is the same floats, XOR-delta filtered per coordinate and split into
+ * byte planes, compressed with zlib; lossless, and about 40% smaller than
+ * the raw block on the recorded highway frames.
+ */
+
+static const char pcdContainerMagic[8] = {'U', 'K', 'F', 'P', 'C', 'D', '1', 0};
+
+enum PcdCodec
+{
+	PCD_RAW = 0,
+	PCD_DEFLATE = 1
+};
+
+struct PcdContainerHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t frameCount;
+	uint64_t indexOffset;
+};
+
+struct PcdFrameInfo
+{
+	int64_t timestamp;
+	uint64_t offset;
+	uint64_t storedBytes;
+	uint32_t points;
+	uint32_t codec;
+};
+
+// true if the zlib codec was compiled in
+bool pcdDeflateAvailable();
+
+// the <name>_<timestamp>.pcd files in directory, sorted by timestamp
+bool listPcdFrames(const std::string& directory, std::vector<std::pair<long long, std::string> >& frames);
+
+// load the x y z fields of an ascii or binary PCD file without PCL
+bool readPcdXyz(const std::string& file, std::vector<float>& xyz);
+
+class PcdContainerWriter
+{
+public:
+	PcdContainerWriter();
+	~PcdContainerWriter();
+
+	// compress falls back to raw blocks if zlib is not available
+	bool open(const std::string& file, bool compress);
+	// frames must be added in increasing timestamp order
+	bool addFrame(int64_t timestamp, const float* xyz, uint32_t points);
+	// writes the index, the container is unusable without it
+	bool close();
+
+private:
+	bool writeBlock(const void* data, size_t bytes);
+	// zeros up to the next 64 byte boundary
+	bool pad();
+
+	FILE* out;
+	bool compress;
+	uint64_t offset;
+	std::vector<PcdFrameInfo> index;
+	std::vector<unsigned char> planes;
+	std::vector<unsigned char> packed;
+};
+
+class PcdContainerReader
+{
+public:
+	PcdContainerReader();
+	~PcdContainerReader();
+
+	bool open(const std::string& file);
+	void close();
+
+	size_t frameCount() const { return index.size(); }
+	const PcdFrameInfo& frame(size_t i) const { return index[i]; }
+	// frame recorded at timestamp, -1 if there is none
+	long findFrame(int64_t timestamp) const;
+	// decode frame i into xyz, reusing its storage
+	bool readFrame(size_t i, std::vector<float>& xyz);
+
+private:
+	FILE* in;
+	std::vector<PcdFrameInfo> index;
+	std::vector<unsigned char> packed;
+	std::vector<unsigned char> planes;
+};
+
+// whether a frame's stored block lies within a file of fileBytes and its
+// point count is one the block can decode to
+bool pcdFrameFits(const PcdFrameInfo& info, uint64_t fileBytes);
+
+// decode one stored block into points*3 floats
+bool decodePcdBlock(const PcdFrameInfo& info, const unsigned char* stored, float* xyz, std::vector<unsigned char>& planes);
+
+#endif /* PCD_CONTAINER_H */
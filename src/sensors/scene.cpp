@@ -0,0 +1,216 @@
+#include "scene.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// cells per axis, beyond this the cells grow instead
+static const int maxCells = 256;
+
+SceneBox::SceneBox(const Vect3& position, double centerZ, const Vect3& half, double yaw)
+	: x(position.x), y(position.y), z(position.z), centerZ(centerZ), half(half),
+	  sinNegTheta(sin(-yaw)), cosNegTheta(cos(-yaw))
+{
+	// half widths of the rotated footprint
+	double ex = std::fabs(cosNegTheta) * half.x + std::fabs(sinNegTheta) * half.y;
+	double ey = std::fabs(sinNegTheta) * half.x + std::fabs(cosNegTheta) * half.y;
+	minX = x - ex;
+	maxX = x + ex;
+	minY = y - ey;
+	maxY = y + ey;
+}
+
+double SceneBox::intersect(const Vect3& origin, const Vect3& direction) const
+{
+	double dx = origin.x - x;
+	double dy = origin.y - y;
+	Vect3 o(dx * cosNegTheta - dy * sinNegTheta, dy * cosNegTheta + dx * sinNegTheta, origin.z - z);
+	Vect3 d(direction.x * cosNegTheta - direction.y * sinNegTheta, direction.y * cosNegTheta + direction.x * sinNegTheta, direction.z);
+	return Car::intersectBox(o, d, half, centerZ);
+}
+
+LidarScene::LidarScene(double cellSize)
+	: cellSize(cellSize), gridMinX(0), gridMinY(0), gridMaxX(0), gridMaxY(0),
+	  cellX(cellSize), cellY(cellSize), cellsX(0), cellsY(0)
+{}
+
+void LidarScene::clear()
+{
+	boxes.clear();
+}
+
+void LidarScene::addCar(const Car& car)
+{
+	const Vect3& dimensions = car.dimensions;
+	addBox(SceneBox(car.position, dimensions.z / 3, Vect3(dimensions.x / 2, dimensions.y / 2, dimensions.z / 3), car.angle));
+	addBox(SceneBox(car.position, dimensions.z * 5 / 6, Vect3(dimensions.x / 4, dimensions.y / 2, dimensions.z / 6), car.angle));
+}
+
+void LidarScene::addHighwayPoles(double distancePos)
+{
+	// keep in sync with renderHighway
+	double roadLengthAhead = 50.0;
+	double roadLengthBehind = -15.0;
+	double roadWidth = 12.0;
+	double poleSpace = 10;
+	double poleCurve = 4;
+	double poleWidth = 0.5;
+	double poleHeight = 3;
+
+	double markerPos = (roadLengthBehind/poleSpace)*poleSpace-distancePos;
+	while(markerPos < roadLengthBehind)
+		markerPos+=poleSpace;
+	Vect3 half(poleWidth / 2, poleWidth / 2, poleHeight / 2);
+	while(markerPos <= roadLengthAhead)
+	{
+		addBox(SceneBox(Vect3(markerPos, roadWidth / 2 + poleCurve, 0), poleHeight / 2, half, 0));
+		addBox(SceneBox(Vect3(markerPos, -roadWidth / 2 - poleCurve, 0), poleHeight / 2, half, 0));
+		markerPos+=poleSpace;
+	}
+}
+
+void LidarScene::addBox(const SceneBox& box)
+{
+	boxes.push_back(box);
+}
+
+void LidarScene::build()
+{
+	cellStart.assign(1, 0);
+	cellBoxes.clear();
+	cellBottom.clear();
+	cellTop.clear();
+	cellsX = cellsY = 0;
+	if(boxes.empty())
+		return;
+
+	gridMinX = gridMinY = std::numeric_limits<double>::infinity();
+	gridMaxX = gridMaxY = -std::numeric_limits<double>::infinity();
+	for(const SceneBox& box : boxes)
+	{
+		gridMinX = std::min(gridMinX, box.minX);
+		gridMaxX = std::max(gridMaxX, box.maxX);
+		gridMinY = std::min(gridMinY, box.minY);
+		gridMaxY = std::max(gridMaxY, box.maxY);
+	}
+	cellX = std::max(cellSize, (gridMaxX - gridMinX) / maxCells);
+	cellY = std::max(cellSize, (gridMaxY - gridMinY) / maxCells);
+	cellsX = std::min(maxCells, (int)((gridMaxX - gridMinX) / cellX) + 1);
+	cellsY = std::min(maxCells, (int)((gridMaxY - gridMinY) / cellY) + 1);
+
+	// count, prefix sum, fill
+	cellStart.assign(cellsX * cellsY + 1, 0);
+	cellBottom.assign(cellsX * cellsY, std::numeric_limits<double>::infinity());
+	cellTop.assign(cellsX * cellsY, -std::numeric_limits<double>::infinity());
+	for(int pass = 0; pass < 2; pass++)
+	{
+		for(int b = 0; b < (int)boxes.size(); b++)
+		{
+			const SceneBox& box = boxes[b];
+			int x0 = std::min(cellsX - 1, (int)((box.minX - gridMinX) / cellX));
+			int x1 = std::min(cellsX - 1, (int)((box.maxX - gridMinX) / cellX));
+			int y0 = std::min(cellsY - 1, (int)((box.minY - gridMinY) / cellY));
+			int y1 = std::min(cellsY - 1, (int)((box.maxY - gridMinY) / cellY));
+			for(int iy = y0; iy <= y1; iy++)
+			{
+				for(int ix = x0; ix <= x1; ix++)
+				{
+					int cell = iy * cellsX + ix;
+					if(pass == 0)
+						cellStart[cell + 1]++;
+					else
+					{
+						cellBoxes[cellStart[cell]++] = b;
+						cellBottom[cell] = std::min(cellBottom[cell], box.z + box.centerZ - box.half.z);
+						cellTop[cell] = std::max(cellTop[cell], box.z + box.centerZ + box.half.z);
+					}
+				}
+			}
+		}
+
+		if(pass == 0)
+		{
+			for(int c = 0; c < cellsX * cellsY; c++)
+				cellStart[c + 1] += cellStart[c];
+			cellBoxes.resize(cellStart.back());
+		}
+	}
+	// the fill pass advanced every start to the next cell's, shift back
+	for(int c = cellsX * cellsY; c > 0; c--)
+		cellStart[c] = cellStart[c - 1];
+	cellStart[0] = 0;
+}
+
+double LidarScene::intersect(const Vect3& origin, const Vect3& direction, double tMax) const
+{
+	const double inf = std::numeric_limits<double>::infinity();
+	if(cellsX == 0)
+		return inf;
+
+	// clip the ray to the grid
+	double t0 = 0, t1 = tMax;
+	const double o[2] = {origin.x, origin.y};
+	const double d[2] = {direction.x, direction.y};
+	const double lo[2] = {gridMinX, gridMinY};
+	const double hi[2] = {gridMaxX, gridMaxY};
+	for(int k = 0; k < 2; k++)
+	{
+		if(d[k] == 0)
+		{
+			if(o[k] < lo[k] || o[k] > hi[k])
+				return inf;
+			continue;
+		}
+		double ta = (lo[k] - o[k]) / d[k];
+		double tb = (hi[k] - o[k]) / d[k];
+		t0 = std::max(t0, std::min(ta, tb));
+		t1 = std::min(t1, std::max(ta, tb));
+	}
+	if(t0 > t1)
+		return inf;
+
+	// walk the cells in ray order (Amanatides and Woo)
+	int ix = std::max(0, std::min(cellsX - 1, (int)((origin.x + t0 * direction.x - gridMinX) / cellX)));
+	int iy = std::max(0, std::min(cellsY - 1, (int)((origin.y + t0 * direction.y - gridMinY) / cellY)));
+	int stepX = direction.x > 0 ? 1 : -1;
+	int stepY = direction.y > 0 ? 1 : -1;
+	double nextX = direction.x == 0 ? inf : (gridMinX + (ix + (stepX > 0)) * cellX - origin.x) / direction.x;
+	double nextY = direction.y == 0 ? inf : (gridMinY + (iy + (stepY > 0)) * cellY - origin.y) / direction.y;
+	double deltaX = direction.x == 0 ? inf : cellX / std::fabs(direction.x);
+	double deltaY = direction.y == 0 ? inf : cellY / std::fabs(direction.y);
+
+	double hit = inf;
+	double cellEnter = t0;
+	while(true)
+	{
+		int cell = iy * cellsX + ix;
+		double cellExit = std::min(nextX, nextY);
+
+		// heights of the ray where it enters and leaves the cell
+		double zEnter = origin.z + cellEnter * direction.z;
+		double zExit = origin.z + std::min(cellExit, t1) * direction.z;
+		if(std::max(zEnter, zExit) >= cellBottom[cell] && std::min(zEnter, zExit) <= cellTop[cell])
+		{
+			for(int k = cellStart[cell]; k < cellStart[cell + 1]; k++)
+				hit = std::min(hit, boxes[cellBoxes[k]].intersect(origin, direction));
+		}
+
+		if(hit <= cellExit || cellExit > t1)
+			break;
+		cellEnter = cellExit;
+		if(nextX < nextY)
+		{
+			ix += stepX;
+			if(ix < 0 || ix >= cellsX)
+				break;
+			nextX += deltaX;
+		}
+		else
+		{
+			iy += stepY;
+			if(iy < 0 || iy >= cellsY)
+				break;
+			nextY += deltaY;
+		}
+	}
+	return hit < tMax ? hit : inf;
+}
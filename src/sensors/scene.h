@@ -0,0 +1,71 @@
+#ifndef SCENE_H
+#define SCENE_H
+#include <vector>
+#include "../car.h"
+
+// a box rotated by yaw about z, the shape every scene object is made of
+struct SceneBox
+{
+	// reference point, the box center is centerZ above it
+	double x, y, z;
+	double centerZ;
+	// half extents in the box frame
+	Vect3 half;
+	double sinNegTheta;
+	double cosNegTheta;
+	// extent on the xy plane, used to place the box in the grid
+	double minX, maxX, minY, maxY;
+
+	SceneBox(const Vect3& position, double centerZ, const Vect3& half, double yaw);
+
+	// same contract as Car::intersect
+	double intersect(const Vect3& origin, const Vect3& direction) const;
+};
+
+/**
+ * The objects a lidar ray can hit, on a uniform grid over the xy plane.
+ *
+ * A ray walks the grid cells it crosses in order and only tests the boxes
+ * registered in them, stopping once a hit lies within the cells walked so
+ * far, so the cost of a ray depends on the traffic around it rather than on
+ * the number of cars. Cells whose boxes lie entirely below or above the
+ * ray's heights over the cell, as for rays passing over the traffic, are
+ * not tested. The grid is rebuilt from scratch every frame, which is linear
+ * in the number of boxes and reuses its storage.
+ */
+class LidarScene
+{
+public:
+	explicit LidarScene(double cellSize = 2.0);
+
+	void clear();
+	// the two boxes of the car body, as in Car::checkCollision
+	void addCar(const Car& car);
+	// the poles next to the highway as drawn by renderHighway
+	void addHighwayPoles(double distancePos);
+	void addBox(const SceneBox& box);
+	// bin the boxes into the grid, call after adding them
+	void build();
+
+	// distance to the nearest hit closer than tMax, or infinity
+	double intersect(const Vect3& origin, const Vect3& direction, double tMax) const;
+
+	int size() const { return boxes.size(); }
+
+private:
+	double cellSize;
+	std::vector<SceneBox> boxes;
+
+	double gridMinX, gridMinY, gridMaxX, gridMaxY;
+	double cellX, cellY;
+	int cellsX, cellsY;
+	// boxes of cell c are cellBoxes[cellStart[c] .. cellStart[c+1])
+	std::vector<int> cellStart;
+	std::vector<int> cellBoxes;
+	// height range of the boxes of each cell, rays passing above or below
+	// it skip the cell's box tests
+	std::vector<double> cellBottom;
+	std::vector<double> cellTop;
+};
+
+#endif /* SCENE_H */
@@ -0,0 +1,165 @@
+// Run highway scenarios without a viewer, as fast as the CPU allows
+//
+// usage: ukf_sim [--seed N] [--scenarios N] [--fps N] [--seconds S] [--results file.csv|file.json] [--trace file.json] [--associate] [--imm] [--sqrt]
+//
+// Runs the scenario once per noise seed, seed .. seed+scenarios-1, and exits
+// with 1 if any of them fails the RMSE threshold check. --trace prints the
+// latency of every frame stage and writes a Chrome trace of the run.
+// --associate also tracks the unlabeled measurements with TrackManager and
+// reports how far its confirmed tracks are from the cars. --imm scores the
+// IMM filter bank's estimates instead of the UKF's. --sqrt tracks with the
+// square-root UKF instead of the standard one.
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <iostream>
+#include <string>
+#include "highway_sim.h"
+#include "scenario_results.h"
+
+int main(int argc, char** argv)
+{
+	// defaults to the noiseSeed parameter of HighwaySim
+	bool seedSet = false;
+	uint64_t firstSeed = 0;
+	int scenarios = 1;
+	int frame_per_sec = 30;
+	double sec_interval = 10;
+	std::string resultsFile;
+	std::string traceFile;
+	bool associate = false;
+	bool useImm = false;
+	bool useSqrt = false;
+
+	for(int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if(i + 1 < argc && arg == "--seed")
+		{
+			firstSeed = std::strtoull(argv[++i], nullptr, 10);
+			seedSet = true;
+		}
+		else if(i + 1 < argc && arg == "--scenarios")
+			scenarios = std::atoi(argv[++i]);
+		else if(i + 1 < argc && arg == "--fps")
+			frame_per_sec = std::atoi(argv[++i]);
+		else if(i + 1 < argc && arg == "--seconds")
+			sec_interval = std::atof(argv[++i]);
+		else if(i + 1 < argc && arg == "--results")
+			resultsFile = argv[++i];
+		else if(i + 1 < argc && arg == "--trace")
+			traceFile = argv[++i];
+		else if(arg == "--associate")
+			associate = true;
+		else if(arg == "--imm")
+			useImm = true;
+		else if(arg == "--sqrt")
+			useSqrt = true;
+		else
+		{
+			std::cerr << "usage: " << argv[0] << " [--seed N] [--scenarios N] [--fps N] [--seconds S] [--results file.csv|file.json] [--trace file.json] [--associate] [--imm] [--sqrt]" << std::endl;
+			return 2;
+		}
+	}
+	if(scenarios < 1 || frame_per_sec < 1)
+	{
+		std::cerr << "scenarios and fps must be positive" << std::endl;
+		return 2;
+	}
+
+	ScenarioResults results;
+	if(!resultsFile.empty() && !results.open(resultsFile))
+	{
+		std::cerr << "Failed to open " << resultsFile << std::endl;
+		return 1;
+	}
+
+	if(!traceFile.empty())
+	{
+#ifndef UKF_TRACE
+		std::cerr << "built without UKF_TRACE, the trace will be empty" << std::endl;
+#endif
+		Tracer::enable(true);
+	}
+
+	int failed = 0;
+	int frames = (int)(frame_per_sec*sec_interval);
+	auto runStart = std::chrono::steady_clock::now();
+	for(int s = 0; s < scenarios; s++)
+	{
+		HighwaySim highway(useSqrt);
+		highway.setNoiseSeed((seedSet ? firstSeed : highway.noiseSeed) + s);
+		highway.associate_detections = associate;
+		highway.use_imm = useImm;
+		// a single run keeps the metrics log, batches would overwrite it
+		if(scenarios > 1)
+			highway.disableMetrics();
+		if(!resultsFile.empty())
+			results.beginScenario(highway.noiseSeed);
+
+		long long time_us = 0;
+		auto startTime = std::chrono::steady_clock::now();
+		for(int frame_count = 0; frame_count < frames; )
+		{
+			auto stepStart = std::chrono::steady_clock::now();
+			highway.step(time_us, frame_per_sec);
+			auto stepEnd = std::chrono::steady_clock::now();
+			if(!resultsFile.empty())
+				results.frame(highway, time_us, std::chrono::duration_cast<std::chrono::nanoseconds>(stepEnd - stepStart).count());
+			frame_count++;
+			time_us = 1000000LL*frame_count/frame_per_sec;
+		}
+		auto endTime = std::chrono::steady_clock::now();
+		auto elapsedTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+
+		if(!resultsFile.empty())
+			results.endScenario(highway);
+		if(!highway.pass)
+			failed++;
+
+		std::cout << "seed " << highway.noiseSeed << ": simulated " << frames << " frames in " << elapsedTime.count() << " us"
+			<< ", RMSE X: " << highway.rmse[0] << " Y: " << highway.rmse[1]
+			<< " Vx: " << highway.rmse[2] << " Vy: " << highway.rmse[3]
+			<< (highway.pass ? "" : ", RMSE Failed Threshold") << std::endl;
+		if(associate)
+		{
+			// distance from every tracked car to the nearest confirmed track
+			double worst = 0;
+			for(int i = 0; i < (int)highway.traffic.size(); i++)
+			{
+				if(!highway.trackCars[i])
+					continue;
+				double nearest = std::numeric_limits<double>::infinity();
+				for(const Track& track : highway.tracker.tracks())
+					if(track.status == Track::CONFIRMED)
+						nearest = std::min(nearest, std::hypot(track.ukf.x_(0) - highway.traffic[i].position.x, track.ukf.x_(1) - highway.traffic[i].position.y));
+				worst = std::max(worst, nearest);
+			}
+			std::cout << "  " << highway.tracker.confirmedCount() << " confirmed of " << highway.tracker.tracks().size()
+				<< " tracks, farthest car " << worst << " m from its nearest confirmed track" << std::endl;
+		}
+	}
+	auto runTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - runStart);
+
+	if(!resultsFile.empty() && !results.close())
+	{
+		std::cerr << "Failed to write " << resultsFile << std::endl;
+		return 1;
+	}
+	if(!traceFile.empty())
+	{
+		Tracer::enable(false);
+		Tracer::summary(std::cout);
+		if(!Tracer::writeChromeTrace(traceFile))
+		{
+			std::cerr << "Failed to write " << traceFile << std::endl;
+			return 1;
+		}
+	}
+	std::cout << scenarios - failed << " of " << scenarios << " scenarios within threshold, " << runTime.count() << " ms" << std::endl;
+
+	return failed ? 1 : 0;
+}
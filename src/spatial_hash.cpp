@@ -0,0 +1,174 @@
+#include "spatial_hash.h"
+#include <algorithm>
+
+namespace
+{
+	const size_t initialSlots = 16;
+}
+
+SpatialHash::SpatialHash(double cellSize)
+	: cellSize_(cellSize)
+{
+	clear();
+}
+
+void SpatialHash::setCellSize(double cellSize)
+{
+	cellSize_ = cellSize;
+	clear();
+}
+
+void SpatialHash::clear()
+{
+	size_t slots = std::max(slots_.size(), initialSlots);
+	slots_.assign(slots, Slot{0, -1});
+	usedSlots_ = 0;
+	shift_ = 64;
+	for (size_t s = slots; s > 1; s >>= 1)
+		shift_--;
+	itemCells_.clear();
+	next_.clear();
+	prev_.clear();
+}
+
+int SpatialHash::find(uint64_t cellKey) const
+{
+	size_t mask = slots_.size() - 1;
+	for (size_t i = home(cellKey); ; i = (i + 1) & mask)
+	{
+		if (slots_[i].head < 0)
+			return -1;
+		if (slots_[i].key == cellKey)
+			return i;
+	}
+}
+
+void SpatialHash::link(uint64_t cellKey, int item)
+{
+	itemCells_[item] = cellKey;
+	prev_[item] = -1;
+	int slot = find(cellKey);
+	if (slot >= 0)
+	{
+		int head = slots_[slot].head;
+		next_[item] = head;
+		prev_[head] = item;
+		slots_[slot].head = item;
+		return;
+	}
+
+	// a new cell, the table stays at most half full
+	if (2 * (usedSlots_ + 1) > (int)slots_.size())
+		grow();
+	size_t mask = slots_.size() - 1;
+	size_t i = home(cellKey);
+	while (slots_[i].head >= 0)
+		i = (i + 1) & mask;
+	slots_[i] = Slot{cellKey, item};
+	next_[item] = -1;
+	usedSlots_++;
+}
+
+void SpatialHash::unlink(int item)
+{
+	int p = prev_[item], n = next_[item];
+	if (n >= 0)
+		prev_[n] = p;
+	if (p >= 0)
+	{
+		next_[p] = n;
+		return;
+	}
+	int slot = find(itemCells_[item]);
+	slots_[slot].head = n;
+	if (n < 0)
+		eraseSlot(slot);
+}
+
+void SpatialHash::eraseSlot(size_t slot)
+{
+	// backward shift deletion, pulls later entries of the probe run into
+	// the hole unless that would move them before their home slot
+	size_t mask = slots_.size() - 1;
+	slots_[slot].head = -1;
+	usedSlots_--;
+	for (size_t j = (slot + 1) & mask; slots_[j].head >= 0; j = (j + 1) & mask)
+	{
+		size_t k = home(slots_[j].key);
+		bool reachable = slot <= j ? (slot < k && k <= j) : (slot < k || k <= j);
+		if (reachable)
+			continue;
+		slots_[slot] = slots_[j];
+		slots_[j].head = -1;
+		slot = j;
+	}
+}
+
+void SpatialHash::grow()
+{
+	std::vector<Slot> old;
+	old.swap(slots_);
+	slots_.assign(old.size() * 2, Slot{0, -1});
+	shift_--;
+	size_t mask = slots_.size() - 1;
+	for (const Slot& s : old)
+	{
+		if (s.head < 0)
+			continue;
+		size_t i = home(s.key);
+		while (slots_[i].head >= 0)
+			i = (i + 1) & mask;
+		slots_[i] = s;
+	}
+}
+
+void SpatialHash::add(double x, double y)
+{
+	itemCells_.push_back(0);
+	next_.push_back(-1);
+	prev_.push_back(-1);
+	link(key(cell(x), cell(y)), itemCells_.size() - 1);
+}
+
+void SpatialHash::move(int item, double x, double y)
+{
+	uint64_t cellKey = key(cell(x), cell(y));
+	if (cellKey == itemCells_[item])
+		return;
+	unlink(item);
+	link(cellKey, item);
+}
+
+void SpatialHash::compact(const std::vector<char>& removed)
+{
+	int count = itemCells_.size();
+	renumbered_.resize(count);
+	int kept = 0;
+	for (int i = 0; i < count; i++)
+		renumbered_[i] = removed[i] ? -1 : kept++;
+	if (kept == count)
+		return;
+
+	for (int i = 0; i < count; i++)
+		if (removed[i])
+			unlink(i);
+
+	// shift the kept items down, lists only link kept items now; an item
+	// moves to an index no larger than its own, so the entries still to be
+	// read are intact
+	for (int i = 0; i < count; i++)
+	{
+		int r = renumbered_[i];
+		if (r < 0)
+			continue;
+		int n = next_[i], p = prev_[i];
+		next_[r] = n < 0 ? -1 : renumbered_[n];
+		prev_[r] = p < 0 ? -1 : renumbered_[p];
+		itemCells_[r] = itemCells_[i];
+		if (p < 0)
+			slots_[find(itemCells_[r])].head = r;
+	}
+	itemCells_.resize(kept);
+	next_.resize(kept);
+	prev_.resize(kept);
+}
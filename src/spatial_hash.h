@@ -0,0 +1,114 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Uniform grid over the x/y plane, hashed so only occupied cells cost memory.
+ *
+ * Items are dense indices 0 .. size()-1 that follow an external array, such
+ * as the track list. The grid is kept across frames and updated
+ * incrementally: moving an item only touches the grid when it changes cell,
+ * and compact() drops items and renumbers the rest the way std::remove_if
+ * does. query() visits every item in the cells a square around a point
+ * overlaps, so with cells about the size of the search radius it looks at
+ * the 3x3 neighborhood only; a square over more cells than are occupied
+ * walks the occupied cells instead.
+ *
+ * Occupied cells live in an open-addressed table and hold an intrusive list
+ * of their items, so moving items between cells does not allocate; the table
+ * only grows with the number of items.
+ */
+class SpatialHash
+{
+public:
+	explicit SpatialHash(double cellSize = 4);
+
+	// changing the cell size empties the grid, both keep the table
+	void setCellSize(double cellSize);
+	double cellSize() const { return cellSize_; }
+	int size() const { return itemCells_.size(); }
+	void clear();
+
+	// appends item size() at x, y
+	void add(double x, double y);
+	void move(int item, double x, double y);
+	// removes the items flagged in removed, the others keep their order
+	void compact(const std::vector<char>& removed);
+
+	// calls visit(item) for the items in the cells within radius of x, y in
+	// either axis; the caller tests the actual distance
+	template <class Visit>
+	void query(double x, double y, double radius, Visit visit) const
+	{
+		if (itemCells_.empty())
+			return;
+		int x0 = cell(x - radius), x1 = cell(x + radius);
+		int y0 = cell(y - radius), y1 = cell(y + radius);
+		if (((int64_t)x1 - x0 + 1) * ((int64_t)y1 - y0 + 1) > usedSlots_)
+		{
+			for (const Slot& s : slots_)
+			{
+				if (s.head < 0)
+					continue;
+				int cx = (int32_t)(s.key >> 32), cy = (int32_t)s.key;
+				if (cx < x0 || cx > x1 || cy < y0 || cy > y1)
+					continue;
+				for (int item = s.head; item >= 0; item = next_[item])
+					visit(item);
+			}
+			return;
+		}
+		for (int cx = x0; cx <= x1; cx++)
+		{
+			for (int cy = y0; cy <= y1; cy++)
+			{
+				int slot = find(key(cx, cy));
+				if (slot < 0)
+					continue;
+				for (int item = slots_[slot].head; item >= 0; item = next_[item])
+					visit(item);
+			}
+		}
+	}
+
+private:
+	// an occupied cell and the first of its items, head < 0 when unused
+	struct Slot
+	{
+		uint64_t key;
+		int head;
+	};
+
+	// cell indices are clamped so far off or NaN positions cannot overflow
+	// them, nor the loops over a range of them
+	static const int maxCell = 1 << 30;
+	int cell(double v) const
+	{
+		double c = std::floor(v / cellSize_);
+		if (!(c > -maxCell))
+			return -maxCell;
+		return c < maxCell ? (int)c : maxCell;
+	}
+	static uint64_t key(int cx, int cy) { return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy; }
+	size_t home(uint64_t cellKey) const { return (cellKey * 0x9E3779B97F4A7C15ull) >> shift_; }
+	int find(uint64_t cellKey) const;
+	void link(uint64_t cellKey, int item);
+	void unlink(int item);
+	void eraseSlot(size_t slot);
+	void grow();
+
+	double cellSize_;
+	std::vector<Slot> slots_;
+	int usedSlots_;
+	// 64 - log2 of the table size
+	int shift_;
+	// cell key and list neighbors of every item
+	std::vector<uint64_t> itemCells_;
+	std::vector<int> next_, prev_;
+	std::vector<int> renumbered_;
+};
+
+#endif /* SPATIAL_HASH_H */
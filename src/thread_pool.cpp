@@ -0,0 +1,103 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads)
+	: batch(nullptr), remaining(0), queued(0), stop(false)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned i = 0; i < threads; i++)
+		queues.emplace_back(new Queue());
+	for (unsigned i = 0; i + 1 < threads; i++)
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stop = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::parallelFor(int n, const std::function<void(int)>& f)
+{
+	if (n <= 0)
+		return;
+
+	std::lock_guard<std::mutex> batchLock(batchMutex);
+	batch = &f;
+	remaining.store(n);
+	long long count = queues.size();
+	for (long long q = 0; q < count; q++)
+	{
+		Queue& queue = *queues[q];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.begin = n * q / count;
+		queue.end = n * (q + 1) / count;
+	}
+	queued.fetch_add(n);
+	if (!workers.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+		}
+		wake.notify_all();
+	}
+
+	int index;
+	while (take(count - 1, index))
+		run(index);
+
+	// nothing left to steal, wait for the tasks still running
+	std::unique_lock<std::mutex> lock(doneMutex);
+	done.wait(lock, [this]() { return remaining.load(std::memory_order_acquire) == 0; });
+}
+
+bool ThreadPool::take(unsigned self, int& index)
+{
+	for (unsigned k = 0; k < queues.size(); k++)
+	{
+		unsigned q = (self + k) % queues.size();
+		Queue& queue = *queues[q];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.begin == queue.end)
+			continue;
+		index = k == 0 ? --queue.end : queue.begin++;
+		queued.fetch_sub(1);
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::run(int index)
+{
+	(*batch)(index);
+	if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		std::lock_guard<std::mutex> lock(doneMutex);
+		done.notify_one();
+	}
+}
+
+void ThreadPool::workerLoop(unsigned self)
+{
+	int index;
+	while (true)
+	{
+		if (take(self, index))
+		{
+			run(index);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wake.wait(lock, [this]() { return stop || queued.load() > 0; });
+		if (stop)
+			return;
+	}
+}
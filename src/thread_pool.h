@@ -0,0 +1,68 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work-stealing thread pool. parallelFor() splits its indices into one
+ * contiguous range per thread, the caller included; every thread takes its
+ * own work from the back of its range and, when that is empty, steals from
+ * the front of the others. Tasks are plain indices into the batch, so
+ * queueing them does not allocate. The caller sleeps once there is nothing
+ * left to steal, until the last running task finishes.
+ */
+class ThreadPool
+{
+public:
+	// threads = 0 uses one per hardware thread; the thread calling
+	// parallelFor() is one of them, so threads - 1 workers are started
+	explicit ThreadPool(unsigned threads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// runs f(0) .. f(n-1) across the pool and returns when all have
+	// finished; calls from several threads run one after the other, and f
+	// must not call parallelFor() on the same pool
+	void parallelFor(int n, const std::function<void(int)>& f);
+
+	unsigned size() const { return queues.size(); }
+
+private:
+	// the indices of the current batch a thread has not handed out yet
+	struct Queue
+	{
+		std::mutex mutex;
+		int begin = 0;
+		int end = 0;
+	};
+
+	// own queue first, then steal round-robin starting after it
+	bool take(unsigned self, int& index);
+	void run(int index);
+	void workerLoop(unsigned self);
+
+	// queue i belongs to worker i, the last one to the caller
+	std::vector<std::unique_ptr<Queue> > queues;
+	std::vector<std::thread> workers;
+
+	std::mutex batchMutex;
+	const std::function<void(int)>* batch;
+	std::atomic<int> remaining;
+	std::mutex doneMutex;
+	std::condition_variable done;
+
+	std::atomic<int> queued;
+	std::atomic<bool> stop;
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+};
+
+#endif /* THREAD_POOL_H */
@@ -1,59 +1,43 @@
-#ifndef TOOLS_H_
-#define TOOLS_H_
-#include <vector>
-#include "Eigen/Dense"
-#include "render/render.h"
-#include <pcl/io/pcd_io.h>
-
-using Eigen::MatrixXd;
-using Eigen::VectorXd;
-using namespace std;
-
-struct lmarker
-{
-	double x, y;
-	lmarker(double setX, double setY)
-		: x(setX), y(setY)
-	{}
-
-};
-
-struct rmarker
-{
-	double rho, phi, rho_dot;
-	rmarker(double setRho, double setPhi, double setRhoDot)
-		: rho(setRho), phi(setPhi), rho_dot(setRhoDot)
-	{}
-
-};
-
-class Tools {
-	public:
-	/**
-	* Constructor.
-	*/
-	Tools();
-	
-	/**
-	* Destructor.
-	*/
-	virtual ~Tools();
-	
-	// Members
-	std::vector<VectorXd> estimations;
-	std::vector<VectorXd> ground_truth;
-	
-	double noise(double stddev, long long seedNum);
-	lmarker lidarSense(Car& car, pcl::visualization::PCLVisualizer::Ptr& viewer, long long timestamp, bool visualize);
-	rmarker radarSense(Car& car, Car ego, pcl::visualization::PCLVisualizer::Ptr& viewer, long long timestamp, bool visualize);
-	void ukfResults(Car car, pcl::visualization::PCLVisualizer::Ptr& viewer, double time, int steps);
-	/**
-	* A helper method to calculate RMSE.
-	*/
-	VectorXd CalculateRMSE(const vector<VectorXd> &estimations, const vector<VectorXd> &ground_truth);
-	void savePcd(typename pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, std::string file);
-	pcl::PointCloud<pcl::PointXYZ>::Ptr loadPcd(std::string file);
-	
-};
-
-#endif /* TOOLS_H_ */
+#ifndef TOOLS_H_
+#define TOOLS_H_
+#include <vector>
+#include "Eigen/Dense"
+#include "render/render.h"
+#include <pcl/io/pcd_io.h>
+#include "sensor_sim.h"
+#include "sensors/frame_store.h"
+
+class Tools : public SensorSim {
+	public:
+	/**
+	* Constructor.
+	*/
+	Tools();
+	
+	/**
+	* Destructor.
+	*/
+	virtual ~Tools();
+	
+	using SensorSim::lidarSense;
+	using SensorSim::radarSense;
+	lmarker lidarSense(Car& car, RenderScene& scene, long long timestamp, bool visualize);
+	rmarker radarSense(Car& car, Car ego, RenderScene& scene, long long timestamp, bool visualize);
+	void renderLidarMarker(const Car& car, const lmarker& marker, RenderScene& scene);
+	void renderRadarMarker(const Car& car, const Car& ego, const rmarker& marker, RenderScene& scene);
+	void ukfResults(Car car, RenderScene& scene, double time, int steps);
+	void savePcd(typename pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, std::string file);
+	pcl::PointCloud<pcl::PointXYZ>::Ptr loadPcd(std::string file);
+	// frame recorded at timestamp from a container written by pcd_pack,
+	// empty if there is none
+	pcl::PointCloud<pcl::PointXYZ>::Ptr loadFrame(const PcdFrameStore& recording, long long timestamp);
+	// same into an existing cloud, scratch holds decoded compressed frames;
+	// uses no Tools state so it can run on a loader thread
+	static bool fillFrame(const PcdFrameStore& recording, long long timestamp, pcl::PointCloud<pcl::PointXYZ>& cloud, std::vector<float>& scratch);
+
+	private:
+	std::vector<float> frameBuffer;
+	
+};
+
+#endif /* TOOLS_H_ */
@@ -0,0 +1,203 @@
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+LatencyHistogram::LatencyHistogram()
+	: count_(0), sum_(0), min_(INT64_MAX), max_(0)
+{
+	std::memset(counts_, 0, sizeof(counts_));
+}
+
+int LatencyHistogram::bucket(int64_t ns)
+{
+	if (ns < SUB_BUCKETS)
+		return ns < 0 ? 0 : (int)ns;
+	// position of the top bit, at least 6 here
+	int exponent = 63 - __builtin_clzll((uint64_t)ns);
+	if (exponent >= MAX_EXPONENT)
+		return BUCKETS - 1;
+	int sub = (int)(ns >> (exponent - 6)) - SUB_BUCKETS;
+	return SUB_BUCKETS * (exponent - 5) + sub;
+}
+
+int64_t LatencyHistogram::bucketLimit(int i)
+{
+	if (i < SUB_BUCKETS)
+		return i;
+	int exponent = i / SUB_BUCKETS + 5;
+	int sub = i % SUB_BUCKETS;
+	return ((int64_t)(SUB_BUCKETS + sub + 1) << (exponent - 6)) - 1;
+}
+
+void LatencyHistogram::record(int64_t ns)
+{
+	counts_[bucket(ns)]++;
+	count_++;
+	sum_ += ns;
+	min_ = std::min(min_, ns);
+	max_ = std::max(max_, ns);
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other)
+{
+	for (int i = 0; i < BUCKETS; i++)
+		counts_[i] += other.counts_[i];
+	count_ += other.count_;
+	sum_ += other.sum_;
+	min_ = std::min(min_, other.min_);
+	max_ = std::max(max_, other.max_);
+}
+
+int64_t LatencyHistogram::percentile(double p) const
+{
+	if (count_ == 0)
+		return 0;
+	uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p * count_ + 0.5));
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKETS; i++)
+	{
+		seen += counts_[i];
+		if (seen >= rank)
+			return std::min(bucketLimit(i), max_);
+	}
+	return max_;
+}
+
+namespace
+{
+	struct Span
+	{
+		int stage;
+		int64_t start;
+		int64_t end;
+	};
+
+	struct ThreadBuffer
+	{
+		int thread;
+		std::vector<Span> spans;
+		std::unique_ptr<LatencyHistogram> histograms[Tracer::MAX_STAGES];
+	};
+
+	std::atomic<bool> tracing(false);
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	// stage names and thread buffers, only locked to register new ones
+	std::mutex registryMutex;
+	std::vector<std::string> stageNames;
+	std::vector<std::unique_ptr<ThreadBuffer> > buffers;
+
+	thread_local ThreadBuffer* localBuffer = nullptr;
+
+	ThreadBuffer* threadBuffer()
+	{
+		if (localBuffer)
+			return localBuffer;
+		std::lock_guard<std::mutex> lock(registryMutex);
+		buffers.emplace_back(new ThreadBuffer());
+		localBuffer = buffers.back().get();
+		localBuffer->thread = buffers.size();
+		return localBuffer;
+	}
+}
+
+void Tracer::enable(bool on)
+{
+	tracing.store(on, std::memory_order_relaxed);
+}
+
+bool Tracer::enabled()
+{
+	return tracing.load(std::memory_order_relaxed);
+}
+
+int Tracer::stage(const char* name)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (size_t i = 0; i < stageNames.size(); i++)
+		if (stageNames[i] == name)
+			return i;
+	// stages past the limit share the last slot rather than fail
+	if (stageNames.size() == MAX_STAGES)
+		return MAX_STAGES - 1;
+	stageNames.push_back(name);
+	return stageNames.size() - 1;
+}
+
+int64_t Tracer::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Tracer::record(int stage, int64_t start, int64_t end)
+{
+	ThreadBuffer* buffer = threadBuffer();
+	std::unique_ptr<LatencyHistogram>& histogram = buffer->histograms[stage];
+	if (!histogram)
+		histogram.reset(new LatencyHistogram());
+	histogram->record(end - start);
+	if (buffer->spans.size() < MAX_SPANS)
+		buffer->spans.push_back(Span{stage, start, end});
+}
+
+void Tracer::summary(std::ostream& out)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	out << "stage                        count      mean_ns       p50_ns       p90_ns       p99_ns     p99.9_ns       max_ns\n";
+	for (size_t s = 0; s < stageNames.size(); s++)
+	{
+		LatencyHistogram total;
+		for (const std::unique_ptr<ThreadBuffer>& buffer : buffers)
+			if (buffer->histograms[s])
+				total.add(*buffer->histograms[s]);
+		if (total.count() == 0)
+			continue;
+		char line[256];
+		std::snprintf(line, sizeof(line), "%-22s %11lld %12.0f %12lld %12lld %12lld %12lld %12lld\n",
+			stageNames[s].c_str(), (long long)total.count(), total.mean(),
+			(long long)total.percentile(0.5), (long long)total.percentile(0.9), (long long)total.percentile(0.99),
+			(long long)total.percentile(0.999), (long long)total.max());
+		out << line;
+	}
+}
+
+bool Tracer::writeChromeTrace(const std::string& file)
+{
+	std::ofstream out(file);
+	if (!out)
+		return false;
+	std::lock_guard<std::mutex> lock(registryMutex);
+	out << "{\"traceEvents\":[";
+	bool first = true;
+	char event[256];
+	for (const std::unique_ptr<ThreadBuffer>& buffer : buffers)
+	{
+		for (const Span& span : buffer->spans)
+		{
+			// complete events, timestamps in microseconds
+			std::snprintf(event, sizeof(event), "%s\n{\"name\":\"%s\",\"cat\":\"ukf\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				first ? "" : ",", stageNames[span.stage].c_str(), buffer->thread, span.start / 1e3, (span.end - span.start) / 1e3);
+			out << event;
+			first = false;
+		}
+	}
+	out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+	return !out.fail();
+}
+
+void Tracer::reset()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (std::unique_ptr<ThreadBuffer>& buffer : buffers)
+	{
+		buffer->spans.clear();
+		for (std::unique_ptr<LatencyHistogram>& histogram : buffer->histograms)
+			histogram.reset();
+	}
+}
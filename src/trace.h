@@ -0,0 +1,117 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * Latency histogram with HDR-style log-linear buckets: exact below 64 ns,
+ * then 64 buckets per power of two, so every recorded value is resolved to
+ * within 1.6% up to about 18 minutes.
+ */
+class LatencyHistogram
+{
+public:
+	static const int SUB_BUCKETS = 64;
+	static const int MAX_EXPONENT = 40;
+	static const int BUCKETS = SUB_BUCKETS * (MAX_EXPONENT - 4);
+
+	LatencyHistogram();
+
+	void record(int64_t ns);
+	void add(const LatencyHistogram& other);
+
+	int64_t count() const { return count_; }
+	int64_t min() const { return count_ ? min_ : 0; }
+	int64_t max() const { return max_; }
+	double mean() const { return count_ ? (double)sum_ / count_ : 0; }
+	// the value at or below which a fraction p of the samples lie, to
+	// bucket precision
+	int64_t percentile(double p) const;
+
+private:
+	static int bucket(int64_t ns);
+	// largest value that falls into bucket i
+	static int64_t bucketLimit(int i);
+
+	uint64_t counts_[BUCKETS];
+	int64_t count_;
+	int64_t sum_;
+	int64_t min_;
+	int64_t max_;
+};
+
+/**
+ * Collects the timings of the trace probes compiled into the frame loop.
+ *
+ * Each thread records into its own buffer, registered on its first probe,
+ * so probes never take a lock or share a cache line. A buffer keeps a
+ * histogram per stage and, up to a fixed capacity, the individual spans for
+ * the Chrome trace. Probes cost a relaxed load while tracing is disabled.
+ * summary() and writeChromeTrace() read every buffer and are meant for when
+ * the traced threads are idle, e.g. at the end of a run.
+ */
+class Tracer
+{
+public:
+	// spans kept per thread for the Chrome trace, later spans only go into
+	// the histograms
+	static const int MAX_SPANS = 1 << 20;
+	static const int MAX_STAGES = 32;
+
+	static void enable(bool on);
+	static bool enabled();
+
+	// id of the named stage, registering it on first use
+	static int stage(const char* name);
+	// ns since the tracer's epoch
+	static int64_t now();
+	static void record(int stage, int64_t start, int64_t end);
+
+	// count, mean and percentiles of every stage over all threads
+	static void summary(std::ostream& out);
+	// the spans as Chrome trace events, for chrome://tracing or Perfetto
+	static bool writeChromeTrace(const std::string& file);
+	static void reset();
+};
+
+/**
+ * Times its own scope as one span of a stage
+ */
+class TraceScope
+{
+public:
+	explicit TraceScope(int stage)
+		: stage_(stage), start_(Tracer::enabled() ? Tracer::now() : -1)
+	{}
+
+	~TraceScope()
+	{
+		if (start_ >= 0)
+			Tracer::record(stage_, start_, Tracer::now());
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	int stage_;
+	int64_t start_;
+};
+
+#define UKF_TRACE_CONCAT_(a, b) a##b
+#define UKF_TRACE_CONCAT(a, b) UKF_TRACE_CONCAT_(a, b)
+
+// UKF_TRACE_SCOPE("stage") times the rest of the enclosing scope; without
+// UKF_TRACE defined it expands to nothing
+#ifdef UKF_TRACE
+#define UKF_TRACE_SCOPE(name) \
+	static const int UKF_TRACE_CONCAT(traceStage, __LINE__) = Tracer::stage(name); \
+	TraceScope UKF_TRACE_CONCAT(traceScope, __LINE__)(UKF_TRACE_CONCAT(traceStage, __LINE__))
+#else
+#define UKF_TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif /* TRACE_H */
@@ -0,0 +1,321 @@
+#include "track_manager.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// large enough that no assignment through a forbidden pair ever wins
+	const double forbidden = 1e9;
+
+	// largest eigenvalue of the symmetric 2x2 [a b; b c]
+	double maxEigenvalue(double a, double b, double c)
+	{
+		double mean = 0.5 * (a + c);
+		double half = 0.5 * (a - c);
+		return mean + std::sqrt(half * half + b * b);
+	}
+
+	LidarModel measurementModel(const UKF& ukf, const LidarModel*) { return ukf.LidarMeasurementModel(); }
+	RadarModel measurementModel(const UKF& ukf, const RadarModel*) { return ukf.RadarMeasurementModel(); }
+}
+
+int TrackManager::confirmedCount() const
+{
+	int count = 0;
+	for (const Track& track : tracks_)
+		if (track.status == Track::CONFIRMED)
+			count++;
+	return count;
+}
+
+void TrackManager::update(const std::vector<MeasurementPackage>& detections)
+{
+	detectionTracks_.assign(detections.size(), -1);
+	if (detections.empty())
+		return;
+	long long timestamp = detections[0].timestamp_;
+	bool laser = detections[0].sensor_type_ == MeasurementPackage::LASER;
+	if (grid_.cellSize() != cellSize)
+	{
+		grid_.setCellSize(cellSize);
+		for (const Track& track : tracks_)
+			grid_.add(track.ukf.x_(0), track.ukf.x_(1));
+	}
+
+	// predict every track to the detections, like ProcessMeasurement does
+	for (Track& track : tracks_)
+	{
+		track.ukf.Prediction((timestamp - track.ukf.time_us_) / 1000000.0);
+		track.ukf.time_us_ = timestamp;
+	}
+
+	// detection positions for the spatial hash
+	detectionX_.resize(detections.size());
+	detectionY_.resize(detections.size());
+	for (size_t j = 0; j < detections.size(); j++)
+	{
+		const Eigen::VectorXd& z = detections[j].raw_measurements_;
+		if (laser)
+		{
+			detectionX_[j] = z(0);
+			detectionY_[j] = z(1);
+		}
+		else
+		{
+			detectionX_[j] = z(0) * std::cos(z(1));
+			detectionY_[j] = z(0) * std::sin(z(1));
+		}
+	}
+
+	double gate = laser ? lidarGate : radarGate;
+	double birthGate = std::max(gate, laser ? lidarBirthGate : radarBirthGate);
+	if (laser)
+		gateTracks<LidarModel>(detections, gate, birthGate);
+	else
+		gateTracks<RadarModel>(detections, gate, birthGate);
+	assign(detections.size(), gate);
+
+	// update the assigned tracks, count a miss for the rest
+	for (size_t t = 0; t < tracks_.size(); t++)
+	{
+		Track& track = tracks_[t];
+		int j = trackDetection_[t];
+		if (j < 0)
+		{
+			track.misses++;
+			continue;
+		}
+		if (laser)
+			track.ukf.UpdateLidar(detections[j]);
+		else
+			track.ukf.UpdateRadar(detections[j]);
+		track.hits++;
+		track.misses = 0;
+		if (track.hits >= confirmHits)
+			track.status = Track::CONFIRMED;
+		detectionTracks_[j] = track.id;
+	}
+
+	removed_.resize(tracks_.size());
+	for (size_t t = 0; t < tracks_.size(); t++)
+	{
+		const Track& track = tracks_[t];
+		removed_[t] = track.misses >= (track.status == Track::CONFIRMED ? confirmedMisses : tentativeMisses);
+	}
+	grid_.compact(removed_);
+	size_t kept = 0;
+	for (size_t t = 0; t < tracks_.size(); t++)
+	{
+		if (removed_[t])
+			continue;
+		if (kept != t)
+			tracks_[kept] = tracks_[t];
+		kept++;
+	}
+	tracks_.erase(tracks_.begin() + kept, tracks_.end());
+
+	// every detection outside all birth gates starts a new track
+	for (size_t j = 0; j < detections.size(); j++)
+	{
+		if (gated_[j])
+			continue;
+		Track track;
+		track.id = nextId_++;
+		track.status = confirmHits <= 1 ? Track::CONFIRMED : Track::TENTATIVE;
+		track.hits = 1;
+		track.misses = 0;
+		track.ukf.track_id_ = track.id;
+		track.ukf.ProcessMeasurement(detections[j]);
+		// a detection fixes the position but not the motion, radar's radial
+		// speed only bounds the speed from below
+		UKF& ukf = track.ukf;
+		ukf.P_(2, 2) = birthSpeedStd * birthSpeedStd;
+		ukf.P_(3, 3) = birthYawStd * birthYawStd;
+		ukf.P_(4, 4) = birthYawRateStd * birthYawRateStd;
+		ukf.S_ = ukf.P_.llt().matrixL();
+		tracks_.push_back(track);
+		grid_.add(ukf.x_(0), ukf.x_(1));
+		detectionTracks_[j] = track.id;
+	}
+}
+
+template <class MeasModel>
+void TrackManager::gateTracks(const std::vector<MeasurementPackage>& detections, double gate, double birthGate)
+{
+	const int n_z = MeasModel::n_z;
+	gates_.resize(tracks_.size());
+	for (size_t t = 0; t < tracks_.size(); t++)
+	{
+		UKF& ukf = tracks_[t].ukf;
+		MeasModel model = measurementModel(ukf, (const MeasModel*)nullptr);
+		Eigen::Matrix<double, n_z, 1> z_pred;
+		Eigen::Matrix<double, n_z, n_z> S;
+		ukf.PredictedMeasurement(model, z_pred, S);
+		Eigen::Matrix<double, n_z, n_z> Sinv = S.inverse();
+
+		Gate& g = gates_[t];
+		for (int i = 0; i < n_z; i++)
+		{
+			g.z[i] = z_pred(i);
+			for (int k = 0; k < n_z; k++)
+				g.Sinv[i * n_z + k] = Sinv(i, k);
+		}
+
+		// the gate ellipse lies within sqrt(gate * largest eigenvalue) of the
+		// position covariance plus sensor noise, linearized for radar
+		g.x = ukf.x_(0);
+		g.y = ukf.x_(1);
+		grid_.move(t, g.x, g.y);
+		double noise = model.R()(0, 0);
+		if (n_z == 3)
+			noise = std::max(noise, (g.x * g.x + g.y * g.y) * model.R()(1, 1));
+		else
+			noise = std::max(noise, model.R()(1, 1));
+		g.radius = std::sqrt(birthGate * (maxEigenvalue(ukf.P_(0, 0), ukf.P_(0, 1), ukf.P_(1, 1)) + noise));
+	}
+	findCandidates(detections, n_z, MeasModel::angle_mask, gate, birthGate);
+}
+
+void TrackManager::findCandidates(const std::vector<MeasurementPackage>& detections, int n_z, unsigned angleMask, double gate, double birthGate)
+{
+	candidates_.clear();
+	gated_.assign(detections.size(), 0);
+	if (tracks_.empty())
+		return;
+
+	auto test = [&](int t, int j) {
+		const Gate& g = gates_[t];
+		double x = detectionX_[j];
+		double y = detectionY_[j];
+		if (std::fabs(g.x - x) > g.radius || std::fabs(g.y - y) > g.radius)
+			return;
+
+		double diff[3];
+		for (int i = 0; i < n_z; i++)
+		{
+			diff[i] = detections[j].raw_measurements_(i) - g.z[i];
+			if (angleMask & (1u << i))
+			{
+				while (diff[i] > M_PI) diff[i] -= 2. * M_PI;
+				while (diff[i] < -M_PI) diff[i] += 2. * M_PI;
+			}
+		}
+		double nis = 0;
+		for (int i = 0; i < n_z; i++)
+			for (int k = 0; k < n_z; k++)
+				nis += diff[i] * g.Sinv[i * n_z + k] * diff[k];
+		if (nis < birthGate)
+			gated_[j] = 1;
+		if (nis < gate)
+			candidates_.push_back(Candidate{t, j, nis, 0});
+	};
+
+	// each detection looks at the neighboring cells for the tracks whose
+	// gate fits in a cell; tracks with wider gates, new or coasting ones,
+	// search a grid of the detections with their own radius instead, so one
+	// wide gate does not widen every detection's search
+	double reach = grid_.cellSize();
+	bool wide = false;
+	for (const Gate& g : gates_)
+		wide = wide || g.radius > reach;
+
+	for (int j = 0; j < (int)detections.size(); j++)
+	{
+		grid_.query(detectionX_[j], detectionY_[j], reach, [&](int t) {
+			if (gates_[t].radius <= reach)
+				test(t, j);
+		});
+	}
+	if (!wide)
+		return;
+
+	detectionGrid_.setCellSize(reach);
+	for (size_t j = 0; j < detections.size(); j++)
+		detectionGrid_.add(detectionX_[j], detectionY_[j]);
+	for (int t = 0; t < (int)gates_.size(); t++)
+	{
+		const Gate& g = gates_[t];
+		if (g.radius <= reach)
+			continue;
+		detectionGrid_.query(g.x, g.y, g.radius, [&](int j) {
+			test(t, j);
+		});
+	}
+}
+
+int TrackManager::find(int node)
+{
+	while (parent_[node] != node)
+	{
+		parent_[node] = parent_[parent_[node]];
+		node = parent_[node];
+	}
+	return node;
+}
+
+void TrackManager::assign(int detectionCount, double gate)
+{
+	int trackCount = tracks_.size();
+	trackDetection_.assign(trackCount, -1);
+
+	// clusters of tracks and detections linked by candidate pairs, tracks
+	// are nodes 0 .. T-1 and detections T .. T+D-1
+	parent_.resize(trackCount + detectionCount);
+	for (size_t i = 0; i < parent_.size(); i++)
+		parent_[i] = i;
+	for (const Candidate& c : candidates_)
+		parent_[find(c.track)] = find(trackCount + c.detection);
+	for (Candidate& c : candidates_)
+		c.cluster = find(c.track);
+	std::sort(candidates_.begin(), candidates_.end(), [](const Candidate& a, const Candidate& b) {
+		if (a.cluster != b.cluster)
+			return a.cluster < b.cluster;
+		return a.track != b.track ? a.track < b.track : a.detection < b.detection;
+	});
+
+	localIndex_.assign(trackCount + detectionCount, -1);
+	for (size_t begin = 0; begin < candidates_.size(); )
+	{
+		int cluster = candidates_[begin].cluster;
+		size_t end = begin;
+		clusterTracks_.clear();
+		clusterDetections_.clear();
+		for (; end < candidates_.size() && candidates_[end].cluster == cluster; end++)
+		{
+			const Candidate& c = candidates_[end];
+			if (localIndex_[c.track] < 0)
+			{
+				localIndex_[c.track] = clusterTracks_.size();
+				clusterTracks_.push_back(c.track);
+			}
+			if (localIndex_[trackCount + c.detection] < 0)
+			{
+				localIndex_[trackCount + c.detection] = clusterDetections_.size();
+				clusterDetections_.push_back(c.detection);
+			}
+		}
+
+		// rows are tracks, columns the detections and then one "unassigned"
+		// column per track that costs the gate
+		int rows = clusterTracks_.size();
+		int cols = clusterDetections_.size() + rows;
+		cost_.assign(rows * cols, forbidden);
+		for (int r = 0; r < rows; r++)
+			cost_[r * cols + clusterDetections_.size() + r] = gate;
+		for (size_t k = begin; k < end; k++)
+		{
+			const Candidate& c = candidates_[k];
+			cost_[localIndex_[c.track] * cols + localIndex_[trackCount + c.detection]] = c.nis;
+		}
+		solver_.solve(cost_, rows, cols, rowToCol_);
+		for (int r = 0; r < rows; r++)
+			if (rowToCol_[r] < (int)clusterDetections_.size())
+				trackDetection_[clusterTracks_[r]] = clusterDetections_[rowToCol_[r]];
+
+		for (int t : clusterTracks_)
+			localIndex_[t] = -1;
+		for (int j : clusterDetections_)
+			localIndex_[trackCount + j] = -1;
+		begin = end;
+	}
+}
@@ -0,0 +1,127 @@
+#ifndef TRACK_MANAGER_H
+#define TRACK_MANAGER_H
+
+#include <vector>
+#include "Eigen/Dense"
+#include "ukf.h"
+#include "assignment.h"
+#include "spatial_hash.h"
+
+struct Track
+{
+	enum Status { TENTATIVE, CONFIRMED };
+
+	int id;
+	Status status;
+	UKF ukf;
+	// associated detections in total and updates without one in a row
+	int hits;
+	int misses;
+};
+
+/**
+ * Multi-target tracking from unlabeled detections by global nearest
+ * neighbor association.
+ *
+ * Each update() takes one sensor's detections at one timestamp. Every track
+ * is predicted to that timestamp; a detection is a candidate for a track if
+ * its NIS against the track's predicted measurement and innovation
+ * covariance S lies inside the chi-square gate. Candidates are found through
+ * a uniform spatial hash over the predicted positions, kept across updates
+ * and only touched for tracks that change cell, so a detection is only
+ * tested against the tracks in its neighboring cells. Tracks whose gate is
+ * wider than a cell search a hash of the detections instead. Tracks and detections linked by
+ * candidate pairs form clusters, and each cluster is assigned on its own
+ * with the Hungarian method, minimizing the total NIS with the gate as the
+ * cost of leaving a track unassigned.
+ *
+ * Assigned tracks are updated. Detections outside the wider birth gate of
+ * every track start tentative tracks, the other unassigned detections are
+ * dropped. Tentative tracks are
+ * confirmed after confirmHits detections, and tracks are deleted after too
+ * many misses in a row.
+ */
+class TrackManager
+{
+public:
+	// Parameters
+	// --------------------------------
+	// 99% chi-square gates for 2 (lidar) and 3 (radar) degrees of freedom
+	double lidarGate = 9.21;
+	double radarGate = 11.34;
+	// 99.99% gates, a detection inside one is taken as a missed detection of
+	// that track rather than a new target
+	double lidarBirthGate = 18.42;
+	double radarBirthGate = 21.11;
+	// detections to confirm a track
+	int confirmHits = 3;
+	// updates in a row without a detection before a track is deleted
+	int tentativeMisses = 2;
+	int confirmedMisses = 6;
+	// prior standard deviations of a new track's speed, yaw and yaw rate,
+	// which its first detection does not measure
+	double birthSpeedStd = 10;
+	double birthYawStd = M_PI;
+	double birthYawRateStd = 1;
+	// edge of a spatial hash cell in m, about the largest gate radius of a
+	// settled track; changing it takes effect on the next update
+	double cellSize = 4;
+	// --------------------------------
+
+	// associates detections of one sensor taken at one timestamp
+	void update(const std::vector<MeasurementPackage>& detections);
+
+	const std::vector<Track>& tracks() const { return tracks_; }
+	int confirmedCount() const;
+	// for each detection of the last update, the id of the track it was
+	// assigned to or started
+	const std::vector<int>& detectionTracks() const { return detectionTracks_; }
+
+private:
+	// predicted measurement of a track and what gating needs of it
+	struct Gate
+	{
+		double z[3];
+		double Sinv[9];
+		// predicted position and a radius around it that holds the birth gate
+		double x, y;
+		double radius;
+	};
+
+	struct Candidate
+	{
+		int track;
+		int detection;
+		double nis;
+		// root of the cluster the pair belongs to
+		int cluster;
+	};
+
+	template <class MeasModel>
+	void gateTracks(const std::vector<MeasurementPackage>& detections, double gate, double birthGate);
+	void findCandidates(const std::vector<MeasurementPackage>& detections, int n_z, unsigned angleMask, double gate, double birthGate);
+	void assign(int detectionCount, double gate);
+	int find(int node);
+
+	std::vector<Track> tracks_;
+	int nextId_ = 0;
+	// predicted positions of tracks_, item t is tracks_[t]
+	SpatialHash grid_;
+	// positions of the current detections, for tracks with wide gates
+	SpatialHash detectionGrid_;
+	std::vector<int> detectionTracks_;
+
+	// per update scratch, kept to avoid reallocating every frame
+	std::vector<Gate> gates_;
+	std::vector<double> detectionX_, detectionY_;
+	std::vector<Candidate> candidates_;
+	std::vector<int> trackDetection_;
+	std::vector<char> gated_, removed_;
+	std::vector<int> parent_;
+	std::vector<int> clusterTracks_, clusterDetections_, localIndex_;
+	std::vector<double> cost_;
+	std::vector<int> rowToCol_;
+	AssignmentSolver solver_;
+};
+
+#endif /* TRACK_MANAGER_H */
@@ -0,0 +1,40 @@
+#include "tracking_scheduler.h"
+
+TrackingScheduler::TrackingScheduler(unsigned threads)
+	: pool(threads)
+{}
+
+void TrackingScheduler::enqueue(UKF& ukf, const MeasurementPackage& meas_package)
+{
+	std::unordered_map<const UKF*, int>::iterator it = slotIndex.find(&ukf);
+	int index;
+	if (it == slotIndex.end())
+	{
+		index = slots.size();
+		slotIndex[&ukf] = index;
+		slots.push_back(TrackSlot());
+		slots[index].ukf = &ukf;
+	}
+	else
+		index = it->second;
+
+	if (slots[index].measurements.empty())
+		active.push_back(index);
+	slots[index].measurements.push_back(meas_package);
+}
+
+void TrackingScheduler::run()
+{
+	pool.parallelFor(active.size(), [this](int k) {
+		TrackSlot& slot = slots[active[k]];
+		for (const MeasurementPackage& meas_package : slot.measurements)
+			slot.ukf->ProcessMeasurement(meas_package);
+	});
+}
+
+void TrackingScheduler::clear()
+{
+	for (int index : active)
+		slots[index].measurements.clear();
+	active.clear();
+}
@@ -0,0 +1,46 @@
+#ifndef TRACKING_SCHEDULER_H
+#define TRACKING_SCHEDULER_H
+
+#include <unordered_map>
+#include <vector>
+#include "ukf.h"
+#include "thread_pool.h"
+
+/**
+ * Runs one frame of UKF updates for many tracks on a thread pool.
+ *
+ * Measurements are queued per track during sensing; run() then processes each
+ * track's measurements, in the order they were queued, as one task. Every
+ * task only touches its own UKF, so the filtered states are identical to the
+ * serial loop regardless of thread count or timing.
+ */
+class TrackingScheduler
+{
+public:
+	// threads = 0 uses one worker per hardware thread
+	explicit TrackingScheduler(unsigned threads = 0);
+
+	// queue a measurement for the track filtered by ukf
+	void enqueue(UKF& ukf, const MeasurementPackage& meas_package);
+
+	// process every queued measurement, tracks in parallel
+	void run();
+
+	// forget the last run()'s measurements
+	void clear();
+
+private:
+	struct TrackSlot
+	{
+		UKF* ukf;
+		std::vector<MeasurementPackage> measurements;
+	};
+
+	std::vector<TrackSlot> slots;
+	std::unordered_map<const UKF*, int> slotIndex;
+	// slots with measurements this frame, in first-enqueue order
+	std::vector<int> active;
+	ThreadPool pool;
+};
+
+#endif /* TRACKING_SCHEDULER_H */
@@ -1,26 +1,43 @@
 #include "ukf.h"
 #include "Eigen/Dense"
+#include "ctrv_kernel.h"
+#include "innovation.h"
+#include "metrics.h"
+#include "trace.h"
 #include <iostream>
 
-using Eigen::MatrixXd;
-using Eigen::VectorXd;
+using Eigen::Matrix;
 
 
 /**
  * Initializes Unscented Kalman filter
  */
-UKF::UKF() {
+template <int NX, int NAUG>
+UnscentedKalmanFilter<NX, NAUG>::UnscentedKalmanFilter() {
+  // the CTRV process model below reads [p_x p_y v yaw yawd nu_a nu_yawdd]
+  static_assert(NX >= 5 && NAUG == NX + 2, "UKF expects a CTRV state augmented with two noise terms");
+
   // if this is false, laser measurements will be ignored (except during init)
   use_laser_ = true;
 
   // if this is false, radar measurements will be ignored (except during init)
   use_radar_ = true;
 
+  // if this is true, the square-root filter is used
+  use_sqrt_ = false;
+
+  // no metrics are recorded until a sink is attached
+  metrics_ = nullptr;
+  track_id_ = -1;
+  nis_laser_ = 0.0;
+  nis_radar_ = 0.0;
+
   // initial state vector
-  x_ = VectorXd(5);
+  x_.fill(0.0);
 
-  // initial covariance matrix
-  P_ = MatrixXd(5, 5);
+  // initial covariance matrix and its Cholesky factor
+  P_.fill(0.0);
+  S_.fill(0.0);
 
   // Process noise standard deviation longitudinal acceleration in m/s^2
   std_a_ = 1;
@@ -56,30 +73,32 @@ UKF::UKF() {
   is_initialized_ = false;
 
   // State dimension
-  n_x_ = 5;
+  n_x_ = NX;
 
   // Augmented state dimension
-  n_aug_ = n_x_ + 2;
+  n_aug_ = NAUG;
 
   // Sigma point spreading parameter
   lambda_ = 3 - n_aug_;
 
   // predicted sigma points matrix
-  Xsig_pred_ = MatrixXd(n_x_, 2 * n_aug_ + 1);
+  Xsig_pred_.fill(0.0);
 
   // Weights of sigma points
-  weights_ =  VectorXd(2 * n_aug_ + 1);
   weights_(0) = lambda_ / (lambda_ +  n_aug_);
-  for(int i = 1; i < (2 * n_aug_ + 1); i++){
+  for(int i = 1; i < n_sig_; i++){
     weights_(i) = 0.5 / (lambda_ +  n_aug_);
   }
 
 }
 
-UKF::~UKF() {}
+template <int NX, int NAUG>
+UnscentedKalmanFilter<NX, NAUG>::~UnscentedKalmanFilter() {}
+
+template <int NX, int NAUG>
+void UnscentedKalmanFilter<NX, NAUG>::ProcessMeasurement(const MeasurementPackage& meas_package) {
+  UKF_TRACE_SCOPE("ukf_process");
 
-void UKF::ProcessMeasurement(MeasurementPackage meas_package) {
-  
   if(!is_initialized_){
 
     time_us_ = meas_package.timestamp_;
@@ -94,11 +113,9 @@ void UKF::ProcessMeasurement(MeasurementPackage meas_package) {
       x_(2) = 0.2;
 
       // set initial covariance matrix
-      P_<< 0.01, 0, 0, 0, 0,
-           0, 0.01, 0, 0, 0,
-           0, 0, 1, 0, 0,
-           0, 0, 0, 1, 0,
-           0, 0, 0, 0, 1;
+      P_.setIdentity();
+      P_(0, 0) = 0.01;
+      P_(1, 1) = 0.01;
 
     }
 
@@ -115,15 +132,18 @@ void UKF::ProcessMeasurement(MeasurementPackage meas_package) {
       x_(4) = 0;
 
       // set initial covariance matrix
-      P_<< 0.01, 0, 0, 0, 0,
-           0, 0.01, 0, 0, 0,
-           0, 0, 0.01, 0, 0,
-           0, 0, 0, 0.09, 0,
-           0, 0, 0, 0, 0.09;
+      P_.setIdentity();
+      P_(0, 0) = 0.01;
+      P_(1, 1) = 0.01;
+      P_(2, 2) = 0.01;
+      P_(3, 3) = 0.09;
+      P_(4, 4) = 0.09;
 
     }
 
-   
+    // square-root filter carries the Cholesky factor from here on
+    S_ = P_.llt().matrixL();
+
     is_initialized_ = true;
     return;
 
@@ -151,33 +171,43 @@ void UKF::ProcessMeasurement(MeasurementPackage meas_package) {
 
 
 
-void UKF::Prediction(double delta_t) {
+template <int NX, int NAUG>
+void UnscentedKalmanFilter<NX, NAUG>::Prediction(double delta_t) {
 
   /**
   *  Generate sigma points for augmented states
   */
   // create augmented mean vector
-  VectorXd x_aug = VectorXd(n_aug_);
+  AugVector x_aug;
 
   // create augmented state covariance
-  MatrixXd P_aug = MatrixXd(n_aug_, n_aug_);
+  AugMatrix P_aug;
 
   // create sigma point matrix
-  MatrixXd Xsig_aug = MatrixXd(n_aug_, 2 * n_aug_ + 1);
+  AugSigmaMatrix Xsig_aug;
  
   // create augmented mean state
-  x_aug.head(n_x_) = x_;
+  x_aug.template head<NX>() = x_;
   x_aug(n_x_) = 0;
   x_aug(n_x_ + 1) = 0;
 
   // create augmented covariance matrix
   P_aug.fill(0.0);
-  P_aug.topLeftCorner(n_x_, n_x_) = P_;
+  P_aug.template topLeftCorner<NX, NX>() = P_;
   P_aug(n_x_, n_x_) = std_a_ * std_a_;
   P_aug(n_x_ + 1, n_x_ + 1) = std_yawdd_ * std_yawdd_;
 
-  // create square root matrix
-  MatrixXd L = P_aug.llt().matrixL();
+  // create square root matrix; the square-root filter already carries the
+  // factor of P_ and the noise block is diagonal, so nothing to factorize
+  AugMatrix L;
+  if (use_sqrt_) {
+    L.fill(0.0);
+    L.template topLeftCorner<NX, NX>() = S_;
+    L(n_x_, n_x_) = std_a_;
+    L(n_x_ + 1, n_x_ + 1) = std_yawdd_;
+  } else {
+    L = P_aug.llt().matrixL();
+  }
 
   // create augmented sigma points
   Xsig_aug.col(0)  = x_aug; 
@@ -192,51 +222,9 @@ void UKF::Prediction(double delta_t) {
   /**
   *  Apply motion model on generated sigma points
   */
-  // predict sigma points
-  for (int i = 0; i < (2 * n_aug_ + 1); ++i) {
-    // extract values for better readability
-    double p_x      = Xsig_aug(0,i);
-    double p_y      = Xsig_aug(1,i);
-    double v        = Xsig_aug(2,i);
-    double yaw      = Xsig_aug(3,i);
-    double yawd     = Xsig_aug(4,i);
-    double nu_a     = Xsig_aug(5,i);
-    double nu_yawdd = Xsig_aug(6,i);
-
-    // predicted state values
-    double px_p, py_p;
-
-    // avoid division by zero
-    if (fabs(yawd) > 0.001) {
-        px_p = p_x + v/yawd * (sin(yaw + yawd * delta_t) - sin(yaw));
-        py_p = p_y + v/yawd * (cos(yaw) - cos(yaw + yawd * delta_t));
-    } else {
-        px_p = p_x + (v * delta_t * cos(yaw));
-        py_p = p_y + (v * delta_t * sin(yaw));
-    }
-
-    double v_p = v;
-    double yaw_p = yaw + (yawd * delta_t);
-    double yawd_p = yawd;
-
-    // add noise
-    px_p = px_p + (0.5 * nu_a * delta_t * delta_t * cos(yaw));
-    py_p = py_p + (0.5 * nu_a * delta_t * delta_t * sin(yaw));
-    v_p = v_p + (nu_a * delta_t);
-
-    yaw_p = yaw_p + (0.5 * nu_yawdd * delta_t * delta_t);
-    yawd_p = yawd_p + (nu_yawdd * delta_t);
+  // predict sigma points with the widest kernel the CPU supports
+  ctrv::PredictSigmaPoints(Xsig_aug.data(), NAUG, Xsig_pred_.data(), NX, n_sig_, delta_t);
 
-    // write predicted sigma point into right column
-    Xsig_pred_(0, i) = px_p;
-    Xsig_pred_(1, i) = py_p;
-    Xsig_pred_(2, i) = v_p;
-    Xsig_pred_(3, i) = yaw_p;
-    Xsig_pred_(4, i) = yawd_p;
-
-  }
-
- 
   // print result
   // std::cout << "Xsig_pred = " << std::endl << Xsig_pred_ << std::endl;
   
@@ -244,15 +232,19 @@ void UKF::Prediction(double delta_t) {
   *  Get predicted mean and covariance
   */
   x_.fill(0.0);
-  for (int i = 0; i < (2 * n_aug_ + 1); ++i) { 
+  for (int i = 0; i < n_sig_; ++i) { 
     x_ = x_ + weights_(i) * Xsig_pred_.col(i);
   }
-  
+
+  if (use_sqrt_ && SquareRootPredictedCovariance()) {
+    return;
+  }
+
   P_.fill(0.0);
   // predicted state covariance matrix
-  for (int i = 0; i < 2 * n_aug_ + 1; ++i) { 
+  for (int i = 0; i < n_sig_; ++i) { 
     // state difference
-    VectorXd x_diff = Xsig_pred_.col(i) - x_;
+    StateVector x_diff = Xsig_pred_.col(i) - x_;
     // angle normalization
     while (x_diff(3)> M_PI) x_diff(3)-=2.*M_PI;
     while (x_diff(3)<-M_PI) x_diff(3)+=2.*M_PI;
@@ -260,194 +252,280 @@ void UKF::Prediction(double delta_t) {
     P_ = P_ + weights_(i) * x_diff * x_diff.transpose() ;
   }
 
+  if (use_sqrt_) {
+    // the square-root downdate lost definiteness, restart from this P_
+    S_ = P_.llt().matrixL();
+  }
 
 }
 
-void UKF::UpdateLidar(MeasurementPackage meas_package) {
+template <int NX, int NAUG>
+void UnscentedKalmanFilter<NX, NAUG>::UpdateLidar(const MeasurementPackage& meas_package) {
+  UnscentedUpdate(LidarMeasurementModel(), meas_package);
+}
 
-  int n_z = 2;
+template <int NX, int NAUG>
+void UnscentedKalmanFilter<NX, NAUG>::UpdateRadar(const MeasurementPackage& meas_package) {
+  UnscentedUpdate(RadarMeasurementModel(), meas_package);
+}
 
-  // create matrix for sigma points in measurement space
-  MatrixXd Zsig = MatrixXd(n_z, 2 * n_aug_ + 1);
+template <int NX, int NAUG>
+template <class MeasModel>
+void UnscentedKalmanFilter<NX, NAUG>::UnscentedUpdate(const MeasModel& model,
+                                                      const MeasurementPackage& meas_package) {
 
-  // mean predicted measurement
-  VectorXd z_pred = VectorXd(n_z);
-  
-  // measurement covariance matrix S
-  MatrixXd S = MatrixXd(n_z, n_z);
+  const int n_z = MeasModel::n_z;
 
-  // transform sigma points into measurement space
-  Zsig.fill(0.0);
-  for (int i = 0; i < (2 * n_aug_ + 1); ++i) {  
-    // measurement model
-    Zsig(0, i) = Xsig_pred_(0, i);      // p_x
-    Zsig(1, i) = Xsig_pred_(1, i);      // p_y
-   
-  }
+  // start of the update, for the latency metric
+  std::chrono::steady_clock::time_point start;
+  if (metrics_) start = std::chrono::steady_clock::now();
 
   // mean predicted measurement
-  z_pred.fill(0.0);
-  for (int i=0; i < (2 * n_aug_ + 1); ++i) {
-    z_pred = z_pred + weights_(i) * Zsig.col(i);
-  }
+  Matrix<double, n_z, 1> z_pred;
 
-  // innovation covariance matrix S
-  S.fill(0.0);
-  for (int i = 0; i < (2 * n_aug_ + 1); ++i) {  
-    // residual
-    VectorXd z_diff = Zsig.col(i) - z_pred;
+  // measurement covariance matrix S
+  Matrix<double, n_z, n_z> S;
 
-    S = S + weights_(i) * z_diff * z_diff.transpose();
-  }
+  // create matrix for cross correlation Tc
+  Matrix<double, NX, n_z> Tc;
+
+  PredictMeasurement(model, z_pred, S, Tc, std::integral_constant<bool, MeasModel::linear>());
 
   // add measurement noise covariance matrix
-  MatrixXd R = MatrixXd(n_z ,n_z);
-  R <<  std_laspx_ * std_laspx_,            0,                         
-                   0,             std_laspy_* std_laspy_;         
-  S = S + R;
+  S = S + model.R();
 
   // print result
   // std::cout << "z_pred: " << std::endl << z_pred << std::endl;
   // std::cout << "S: " << std::endl << S << std::endl;
 
-  // create matrix for cross correlation Tc
-  MatrixXd Tc = MatrixXd(n_x_, n_z);
-
-  // calculate cross correlation matrix
-  Tc.fill(0.0);
-  for (int i = 0; i < (2 * n_aug_ + 1); ++i) {  
-    // residual
-    VectorXd z_diff = Zsig.col(i) - z_pred;
-    
-    // state difference
-    VectorXd x_diff = Xsig_pred_.col(i) - x_;
-    // angle normalization
-    while (x_diff(3)> M_PI) x_diff(3)-=2.*M_PI;
-    while (x_diff(3)<-M_PI) x_diff(3)+=2.*M_PI;
-
-    Tc = Tc + weights_(i) * x_diff * z_diff.transpose();
-  }
-
-  // Kalman gain K;
-  MatrixXd K = Tc * S.inverse();
-
   // residual
-  VectorXd z_diff =   meas_package.raw_measurements_ - z_pred;
+  Matrix<double, n_z, 1> z_diff = meas_package.raw_measurements_ - z_pred;
 
   // angle normalization
-  while (z_diff(1)> M_PI) z_diff(1)-=2.*M_PI;
-  while (z_diff(1)<-M_PI) z_diff(1)+=2.*M_PI;
-
-  // update state mean and covariance matrix
-  x_ = x_ + K * z_diff;
-  P_ = P_ - K*S*K.transpose();
+  NormalizeAngles<MeasModel::angle_mask>(z_diff);
+
+  // factorize S once for both the Kalman gain and the NIS
+  double nis;
+  if (use_sqrt_) {
+    // S = Sz * Sz^T; the square-root update needs Sz itself
+    Matrix<double, n_z, n_z> Sz = S.llt().matrixL();
+    SquareRootUpdate<n_z>(Tc, Sz, z_diff);
+    nis = Sz.template triangularView<Eigen::Lower>().solve(z_diff).squaredNorm();
+  } else {
+    InnovationSolver<n_z> S_solver(S);
+
+    // Kalman gain K;
+    Matrix<double, NX, n_z> K = S_solver.Gain(Tc);
+
+    // update state mean and covariance matrix; K*S*K^T = K*Tc^T
+    x_ = x_ + K * z_diff;
+    P_ = P_ - K * Tc.transpose();
+    nis = S_solver.Nis(z_diff);
+  }
 
-  // Calculate NIS 
-  double nis_lidar= z_diff.transpose() * S.inverse() * z_diff;
-  std::cout << "NIS_lidar = " << nis_lidar << std::endl;
+  // hand the NIS to the metrics sink
+  if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
+    nis_laser_ = nis;
+  } else {
+    nis_radar_ = nis;
+  }
+  if (metrics_) {
+    PublishMetric<n_z>(meas_package, z_diff, nis, start);
+  }
 
+}
 
+template <int NX, int NAUG>
+template <class MeasModel>
+void UnscentedKalmanFilter<NX, NAUG>::PredictedMeasurement(const MeasModel& model,
+                                                           Matrix<double, MeasModel::n_z, 1>& z_pred,
+                                                           Matrix<double, MeasModel::n_z, MeasModel::n_z>& S) {
+  Matrix<double, NX, MeasModel::n_z> Tc;
+  PredictMeasurement(model, z_pred, S, Tc, std::integral_constant<bool, MeasModel::linear>());
+  S = S + model.R();
 }
 
-void UKF::UpdateRadar(MeasurementPackage meas_package) {
+template <int NX, int NAUG>
+template <class MeasModel>
+void UnscentedKalmanFilter<NX, NAUG>::PredictMeasurement(const MeasModel& model,
+                                                         Matrix<double, MeasModel::n_z, 1>& z_pred,
+                                                         Matrix<double, MeasModel::n_z, MeasModel::n_z>& S,
+                                                         Matrix<double, NX, MeasModel::n_z>& Tc,
+                                                         std::false_type) {
 
-  int n_z = 3;
+  const int n_z = MeasModel::n_z;
 
   // create matrix for sigma points in measurement space
-  MatrixXd Zsig = MatrixXd(n_z, 2 * n_aug_ + 1);
-
-  // mean predicted measurement
-  VectorXd z_pred = VectorXd(n_z);
-  
-  // measurement covariance matrix S
-  MatrixXd S = MatrixXd(n_z, n_z);
+  Matrix<double, n_z, n_sig_> Zsig;
 
   // transform sigma points into measurement space
-  Zsig.fill(0.0);
-  for (int i = 0; i < (2 * n_aug_ + 1); ++i) {  
-    // extract values for better readability
-    double p_x = Xsig_pred_(0, i);
-    double p_y = Xsig_pred_(1, i);
-    double v   = Xsig_pred_(2, i);
-    double yaw = Xsig_pred_(3, i);
-
-    double v1 = cos(yaw)*v;
-    double v2 = sin(yaw)*v;
-
-    // measurement model
-    Zsig(0,i) = sqrt(p_x * p_x + p_y * p_y);                           // r
-    Zsig(1,i) = atan2(p_y, p_x);                                       // phi
-    Zsig(2,i) = (p_x * v1 + p_y * v2) / sqrt(p_x * p_x + p_y * p_y);   // r_dot
+  for (int i = 0; i < n_sig_; ++i) {
+    Zsig.col(i) = model.h(Xsig_pred_.col(i));
   }
 
   // mean predicted measurement
   z_pred.fill(0.0);
-  for (int i=0; i < (2 * n_aug_ + 1); ++i) {
+  for (int i=0; i < n_sig_; ++i) {
     z_pred = z_pred + weights_(i) * Zsig.col(i);
   }
 
-  // innovation covariance matrix S
+  // innovation covariance matrix S and cross correlation matrix Tc
   S.fill(0.0);
-  for (int i = 0; i < (2 * n_aug_ + 1); ++i) {  // 2n+1 simga points
+  Tc.fill(0.0);
+  for (int i = 0; i < n_sig_; ++i) {
     // residual
-    VectorXd z_diff = Zsig.col(i) - z_pred;
+    Matrix<double, n_z, 1> z_diff = Zsig.col(i) - z_pred;
+    // angle normalization
+    NormalizeAngles<MeasModel::angle_mask>(z_diff);
 
+    // state difference
+    StateVector x_diff = Xsig_pred_.col(i) - x_;
     // angle normalization
-    while (z_diff(1)> M_PI) z_diff(1)-=2.*M_PI;
-    while (z_diff(1)<-M_PI) z_diff(1)+=2.*M_PI;
+    while (x_diff(3)> M_PI) x_diff(3)-=2.*M_PI;
+    while (x_diff(3)<-M_PI) x_diff(3)+=2.*M_PI;
 
     S = S + weights_(i) * z_diff * z_diff.transpose();
+    Tc = Tc + weights_(i) * x_diff * z_diff.transpose();
   }
+}
 
-  // add measurement noise covariance matrix
-  MatrixXd R = MatrixXd(n_z ,n_z);
-  R <<  std_radr_ * std_radr_,            0,                          0,
-                   0,             std_radphi_* std_radphi_,           0,
-                   0,                   0,                   std_radrd_ *std_radrd_;
-  S = S + R;
-
-  // print result
-  // std::cout << "z_pred: " << std::endl << z_pred << std::endl;
-  // std::cout << "S: " << std::endl << S << std::endl;
+template <int NX, int NAUG>
+template <class MeasModel>
+void UnscentedKalmanFilter<NX, NAUG>::PredictMeasurement(const MeasModel& model,
+                                                         Matrix<double, MeasModel::n_z, 1>& z_pred,
+                                                         Matrix<double, MeasModel::n_z, MeasModel::n_z>& S,
+                                                         Matrix<double, NX, MeasModel::n_z>& Tc,
+                                                         std::true_type) {
+
+  const int n_z = MeasModel::n_z;
+
+  // a linear h transforms the sigma points exactly, so the unscented
+  // transform reduces to the Kalman filter moments
+  if (MeasModel::selection) {
+    // H = [I 0]: every moment is a block of x_ and P_, no products needed
+    z_pred = x_.template head<n_z>();
+    Tc = P_.template leftCols<n_z>();
+    S = P_.template topLeftCorner<n_z, n_z>();
+  } else {
+    Matrix<double, n_z, NX> H = model.template H<NX>();
+    z_pred = H * x_;
+    Tc = P_ * H.transpose();
+    S = H * Tc;
+  }
+}
 
-  // create matrix for cross correlation Tc
-  MatrixXd Tc = MatrixXd(n_x_, n_z);
+template <int NX, int NAUG>
+template <int NZ>
+void UnscentedKalmanFilter<NX, NAUG>::PublishMetric(const MeasurementPackage& meas_package,
+                                                    const Matrix<double, NZ, 1>& z_diff, double nis,
+                                                    std::chrono::steady_clock::time_point start) {
+  UpdateMetric metric;
+  metric.timestamp_us = meas_package.timestamp_;
+  metric.track_id = track_id_;
+  metric.sensor = meas_package.sensor_type_;
+  metric.n_z = NZ;
+  metric.nis = nis;
+  for (int i = 0; i < NZ; ++i) {
+    metric.innovation[i] = z_diff(i);
+  }
+  metric.latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  metrics_->publish(metric);
+}
 
-  // calculate cross correlation matrix
-  Tc.fill(0.0);
-  for (int i = 0; i < (2 * n_aug_ + 1); ++i) {  
-    // residual
-    VectorXd z_diff = Zsig.col(i) - z_pred;
-    // angle normalization
-    while (z_diff(1)> M_PI) z_diff(1)-=2.*M_PI;
-    while (z_diff(1)<-M_PI) z_diff(1)+=2.*M_PI;
+template <int NX, int NAUG>
+bool UnscentedKalmanFilter<NX, NAUG>::SquareRootPredictedCovariance() {
 
-    // state difference
-    VectorXd x_diff = Xsig_pred_.col(i) - x_;
+  // weighted deviations of sigma points 1..2n as rows; their QR gives the
+  // upper factor R with R^T R = sum_i w_i x_diff_i x_diff_i^T
+  Matrix<double, n_sig_ - 1, NX> A;
+  for (int i = 1; i < n_sig_; ++i) {
+    StateVector x_diff = Xsig_pred_.col(i) - x_;
     // angle normalization
     while (x_diff(3)> M_PI) x_diff(3)-=2.*M_PI;
     while (x_diff(3)<-M_PI) x_diff(3)+=2.*M_PI;
 
-    Tc = Tc + weights_(i) * x_diff * z_diff.transpose();
+    A.row(i - 1) = sqrt(weights_(i)) * x_diff.transpose();
+  }
+  Eigen::HouseholderQR<Matrix<double, n_sig_ - 1, NX> > qr(A);
+  StateMatrix R = qr.matrixQR().template topLeftCorner<NX, NX>().template triangularView<Eigen::Upper>();
+  S_ = R.transpose();
+
+  // Householder QR may leave negative diagonal entries; flip those columns
+  // so the rank-1 updates below see a proper Cholesky factor
+  for (int k = 0; k < NX; ++k) {
+    if (S_(k, k) < 0) S_.col(k) = -S_.col(k);
   }
 
-  // Kalman gain K;
-  MatrixXd K = Tc * S.inverse();
+  // fold in sigma point 0; its weight is negative for lambda < 0 which
+  // makes this a downdate
+  StateVector x_diff = Xsig_pred_.col(0) - x_;
+  while (x_diff(3)> M_PI) x_diff(3)-=2.*M_PI;
+  while (x_diff(3)<-M_PI) x_diff(3)+=2.*M_PI;
+  if (!CholeskyRankUpdate(S_, x_diff, weights_(0))) {
+    return false;
+  }
 
-  // residual
-  VectorXd z_diff =   meas_package.raw_measurements_ - z_pred;
+  P_ = S_ * S_.transpose();
+  return true;
+}
 
-  // angle normalization
-  while (z_diff(1)> M_PI) z_diff(1)-=2.*M_PI;
-  while (z_diff(1)<-M_PI) z_diff(1)+=2.*M_PI;
+template <int NX, int NAUG>
+template <int NZ>
+void UnscentedKalmanFilter<NX, NAUG>::SquareRootUpdate(const Matrix<double, NX, NZ>& Tc,
+                                                       const Matrix<double, NZ, NZ>& Sz,
+                                                       const Matrix<double, NZ, 1>& z_diff) {
+
+  // Kalman gain K = Tc * S^-1 via two triangular solves
+  Matrix<double, NZ, NX> Kt = Sz.template triangularView<Eigen::Lower>().solve(Tc.transpose());
+  Sz.transpose().template triangularView<Eigen::Upper>().solveInPlace(Kt);
+  Matrix<double, NX, NZ> K = Kt.transpose();
 
-  // update state mean and covariance matrix
+  // update state mean
   x_ = x_ + K * z_diff;
-  P_ = P_ - K*S*K.transpose();
 
-  // Calculate NIS 
-  double nis_radar = z_diff.transpose() * S.inverse() * z_diff;
-  std::cout << "NIS_radar = " << nis_radar << std::endl;
+  // P - K*S*K^T = P - U*U^T with U = K*Sz, one downdate per column of U
+  Matrix<double, NX, NZ> U = K * Sz;
+  StateMatrix S_prev = S_;
+  for (int j = 0; j < NZ; ++j) {
+    if (!CholeskyRankUpdate(S_, StateVector(U.col(j)), -1.0)) {
+      // numerically indefinite; fall back to the plain update and refactor
+      P_ = S_prev * S_prev.transpose() - U * U.transpose();
+      S_ = P_.llt().matrixL();
+      return;
+    }
+  }
+
+  P_ = S_ * S_.transpose();
+}
+
+template <int NX, int NAUG>
+bool UnscentedKalmanFilter<NX, NAUG>::CholeskyRankUpdate(StateMatrix& L, StateVector v, double sigma) {
 
+  // L L^T + sigma v v^T, rotating v into L one column at a time
+  double sign = sigma < 0 ? -1.0 : 1.0;
+  v *= sqrt(fabs(sigma));
+  for (int k = 0; k < NX; ++k) {
+    double r2 = L(k, k) * L(k, k) + sign * v(k) * v(k);
+    if (!(r2 > 0)) {
+      return false;
+    }
+    double r = sqrt(r2);
+    double c = r / L(k, k);
+    double s = v(k) / L(k, k);
+    L(k, k) = r;
+    for (int i = k + 1; i < NX; ++i) {
+      L(i, k) = (L(i, k) + sign * s * v(i)) / c;
+      v(i) = c * v(i) - s * L(i, k);
+    }
+  }
+  return true;
+}
 
-}
\ No newline at end of file
+// CTRV configuration used by the highway tracker
+template class UnscentedKalmanFilter<5, 7>;
+template void UnscentedKalmanFilter<5, 7>::UnscentedUpdate(const LidarModel&, const MeasurementPackage&);
+template void UnscentedKalmanFilter<5, 7>::UnscentedUpdate(const RadarModel&, const MeasurementPackage&);
+template void UnscentedKalmanFilter<5, 7>::UnscentedUpdate(const LidarSigmaPointModel&, const MeasurementPackage&);
+template void UnscentedKalmanFilter<5, 7>::PredictedMeasurement(const LidarModel&, Matrix<double, 2, 1>&, Matrix<double, 2, 2>&);
+template void UnscentedKalmanFilter<5, 7>::PredictedMeasurement(const RadarModel&, Matrix<double, 3, 1>&, Matrix<double, 3, 3>&);
@@ -1,26 +1,52 @@
 #ifndef UKF_H
 #define UKF_H
 
+#include <chrono>
+#include <type_traits>
 #include "Eigen/Dense"
 #include "measurement_package.h"
-
-class UKF {
+#include "measurement_models.h"
+
+class MetricsSink;
+
+/**
+ * Unscented Kalman filter with compile-time state and augmented state
+ * dimensions. All state, covariance and sigma point storage is fixed-size,
+ * so a predict+update cycle does not touch the heap.
+ * @tparam NX State dimension
+ * @tparam NAUG Augmented state dimension (state plus process noise)
+ */
+template <int NX, int NAUG>
+class UnscentedKalmanFilter {
  public:
+  // number of sigma points
+  static const int n_sig_ = 2 * NAUG + 1;
+
+  typedef Eigen::Matrix<double, NX, 1> StateVector;
+  typedef Eigen::Matrix<double, NX, NX> StateMatrix;
+  typedef Eigen::Matrix<double, NAUG, 1> AugVector;
+  typedef Eigen::Matrix<double, NAUG, NAUG> AugMatrix;
+  typedef Eigen::Matrix<double, NAUG, n_sig_> AugSigmaMatrix;
+  typedef Eigen::Matrix<double, NX, n_sig_> SigmaMatrix;
+  typedef Eigen::Matrix<double, n_sig_, 1> WeightVector;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
   /**
    * Constructor
    */
-  UKF();
+  UnscentedKalmanFilter();
 
   /**
    * Destructor
    */
-  virtual ~UKF();
+  virtual ~UnscentedKalmanFilter();
 
   /**
    * ProcessMeasurement
    * @param meas_package The latest measurement data of either radar or laser
    */
-  void ProcessMeasurement(MeasurementPackage meas_package);
+  void ProcessMeasurement(const MeasurementPackage& meas_package);
 
   /**
    * Prediction Predicts sigma points, the state, and the state covariance
@@ -33,13 +59,39 @@ class UKF {
    * Updates the state and the state covariance matrix using a laser measurement
    * @param meas_package The measurement at k+1
    */
-  void UpdateLidar(MeasurementPackage meas_package);
+  void UpdateLidar(const MeasurementPackage& meas_package);
 
   /**
    * Updates the state and the state covariance matrix using a radar measurement
    * @param meas_package The measurement at k+1
    */
-  void UpdateRadar(MeasurementPackage meas_package);
+  void UpdateRadar(const MeasurementPackage& meas_package);
+
+  /**
+   * Updates the state and the state covariance matrix with any measurement
+   * model from measurement_models.h
+   * @param model Measurement function, noise and angular components
+   * @param meas_package The measurement at k+1
+   */
+  template <class MeasModel>
+  void UnscentedUpdate(const MeasModel& model, const MeasurementPackage& meas_package);
+
+  /**
+   * Predicted measurement and innovation covariance S, measurement noise
+   * included, from the last Prediction; what an update would compare the
+   * measurement against, without applying it
+   * @param model Measurement function, noise and angular components
+   * @param z_pred Predicted measurement
+   * @param S Innovation covariance
+   */
+  template <class MeasModel>
+  void PredictedMeasurement(const MeasModel& model,
+                            Eigen::Matrix<double, MeasModel::n_z, 1>& z_pred,
+                            Eigen::Matrix<double, MeasModel::n_z, MeasModel::n_z>& S);
+
+  // the measurement models UpdateLidar and UpdateRadar use
+  LidarModel LidarMeasurementModel() const { return LidarModel(std_laspx_, std_laspy_); }
+  RadarModel RadarMeasurementModel() const { return RadarModel(std_radr_, std_radphi_, std_radrd_); }
 
 
   // initially set to false, set to true in first call of ProcessMeasurement
@@ -51,14 +103,31 @@ class UKF {
   // if this is false, radar measurements will be ignored (except for init)
   bool use_radar_;
 
+  // if this is true, the filter propagates the Cholesky factor S_ of P_
+  // (square-root UKF) instead of refactorizing P_ every prediction
+  bool use_sqrt_;
+
+  // if set, every update publishes its NIS, innovation and latency here
+  MetricsSink* metrics_;
+
+  // track identifier reported with published metrics
+  int track_id_;
+
+  // NIS of the latest laser and radar update
+  double nis_laser_;
+  double nis_radar_;
+
   // state vector: [pos1 pos2 vel_abs yaw_angle yaw_rate] in SI units and rad
-  Eigen::VectorXd x_;
+  StateVector x_;
 
   // state covariance matrix
-  Eigen::MatrixXd P_;
+  StateMatrix P_;
+
+  // lower Cholesky factor of P_, maintained when use_sqrt_ is set
+  StateMatrix S_;
 
   // predicted sigma points matrix
-  Eigen::MatrixXd Xsig_pred_;
+  SigmaMatrix Xsig_pred_;
 
   // time when the state is true, in us
   long long time_us_;
@@ -85,7 +154,7 @@ class UKF {
   double std_radrd_ ;
 
   // Weights of sigma points
-  Eigen::VectorXd weights_;
+  WeightVector weights_;
 
   // State dimension
   int n_x_;
@@ -95,6 +164,49 @@ class UKF {
 
   // Sigma point spreading parameter
   double lambda_;
+
+ private:
+  // predicted measurement mean, innovation covariance without noise and
+  // state/measurement cross correlation, from the sigma points
+  template <class MeasModel>
+  void PredictMeasurement(const MeasModel& model,
+                          Eigen::Matrix<double, MeasModel::n_z, 1>& z_pred,
+                          Eigen::Matrix<double, MeasModel::n_z, MeasModel::n_z>& S,
+                          Eigen::Matrix<double, NX, MeasModel::n_z>& Tc,
+                          std::false_type);
+
+  // same moments in closed form for a linear model
+  template <class MeasModel>
+  void PredictMeasurement(const MeasModel& model,
+                          Eigen::Matrix<double, MeasModel::n_z, 1>& z_pred,
+                          Eigen::Matrix<double, MeasModel::n_z, MeasModel::n_z>& S,
+                          Eigen::Matrix<double, NX, MeasModel::n_z>& Tc,
+                          std::true_type);
+
+  // publishes one update to metrics_
+  template <int NZ>
+  void PublishMetric(const MeasurementPackage& meas_package,
+                     const Eigen::Matrix<double, NZ, 1>& z_diff, double nis,
+                     std::chrono::steady_clock::time_point start);
+
+  // square-root predicted covariance from the predicted sigma points;
+  // false if the downdate with the center point failed
+  bool SquareRootPredictedCovariance();
+
+  // square-root measurement update of x_ and S_, given the lower Cholesky
+  // factor Sz of the innovation covariance; the small S always includes R,
+  // so factoring it directly is cheap and well conditioned
+  template <int NZ>
+  void SquareRootUpdate(const Eigen::Matrix<double, NX, NZ>& Tc,
+                        const Eigen::Matrix<double, NZ, NZ>& Sz,
+                        const Eigen::Matrix<double, NZ, 1>& z_diff);
+
+  // in-place rank-1 update (sigma > 0) or downdate (sigma < 0) of a lower
+  // Cholesky factor: L L^T + sigma v v^T; false if the result is not positive definite
+  static bool CholeskyRankUpdate(StateMatrix& L, StateVector v, double sigma);
 };
 
-#endif  // UKF_H
\ No newline at end of file
+// CTRV filter: [p_x p_y v yaw yawd] augmented with [nu_a nu_yawdd]
+typedef UnscentedKalmanFilter<5, 7> UKF;
+
+#endif  // UKF_H
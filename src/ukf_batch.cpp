@@ -0,0 +1,427 @@
+#include "ukf_batch.h"
+#include <algorithm>
+#include <cmath>
+#include "ctrv_kernel.h"
+
+using Eigen::ArrayXd;
+using Eigen::ArrayXXd;
+
+// rows [begin, begin + n) of a per-track array, or of a block sized scratch array
+typedef Eigen::Block<ArrayXXd> Rows;
+
+namespace {
+
+// CTRV dimensions, shared with the single-track UKF
+const int n_x = 5;
+const int n_aug = 7;
+const int n_sig = 2 * n_aug + 1;
+
+// tracks per block; the scratch of one block stays in L2 across all passes
+const int kBlock = 64;
+
+// column of component k of sigma point i
+inline int sig(int k, int i) { return k * n_sig + i; }
+
+// column of entry (r, c) of an n x n matrix
+inline int idx(int r, int c, int n) { return r * n + c; }
+
+// angle normalization into [-pi, pi) without data dependent branches
+struct NormalizeAngle {
+  typedef double result_type;
+  double operator()(double a) const {
+    return a - 2. * M_PI * std::floor((a + M_PI) / (2. * M_PI));
+  }
+};
+
+}  // namespace
+
+/**
+ * Initializes the batch with the same noise settings as UKF
+ */
+UKFBatch::UKFBatch(int n_tracks)
+  : n_tracks_(n_tracks),
+    is_initialized_(n_tracks, false),
+    time_us_(n_tracks, 0),
+    x_(ArrayXXd::Zero(n_tracks, n_x)),
+    P_(ArrayXXd::Zero(n_tracks, n_x * n_x)),
+    Xsig_pred_(ArrayXXd::Zero(n_tracks, n_x * n_sig)),
+    dt_(ArrayXd::Zero(n_tracks)),
+    gain_mask_(ArrayXd::Zero(n_tracks)),
+    L_(kBlock, n_x * n_x),
+    Xsig_aug_(kBlock, n_aug * n_sig),
+    Xdiff_(kBlock, n_x * n_sig),
+    Zsig_(kBlock, 3 * n_sig),
+    Zdiff_(kBlock, 3 * n_sig),
+    z_pred_(kBlock, 3),
+    S_(kBlock, 3 * 3),
+    Sinv_(kBlock, 3 * 3),
+    det_(kBlock),
+    Tc_(kBlock, n_x * 3),
+    K_(kBlock, n_x * 3),
+    z_res_(kBlock, 3) {
+
+  UKF ukf;
+
+  std_a_ = ukf.std_a_;
+  std_yawdd_ = ukf.std_yawdd_;
+  std_laspx_ = ukf.std_laspx_;
+  std_laspy_ = ukf.std_laspy_;
+  std_radr_ = ukf.std_radr_;
+  std_radphi_ = ukf.std_radphi_;
+  std_radrd_ = ukf.std_radrd_;
+  weights_ = ukf.weights_;
+  lambda_ = ukf.lambda_;
+}
+
+UKFBatch::~UKFBatch() {}
+
+void UKFBatch::ProcessLidar(long long timestamp, const ArrayXXd& z) {
+  Prepare(timestamp, MeasurementPackage::LASER, z);
+  for (int begin = 0; begin < n_tracks_; begin += kBlock) {
+    int n = std::min(kBlock, n_tracks_ - begin);
+    PredictBlock(begin, n, dt_);
+    UpdateLidarBlock(begin, n, z);
+  }
+}
+
+void UKFBatch::ProcessRadar(long long timestamp, const ArrayXXd& z) {
+  Prepare(timestamp, MeasurementPackage::RADAR, z);
+  for (int begin = 0; begin < n_tracks_; begin += kBlock) {
+    int n = std::min(kBlock, n_tracks_ - begin);
+    PredictBlock(begin, n, dt_);
+    UpdateRadarBlock(begin, n, z);
+  }
+}
+
+void UKFBatch::Prepare(long long timestamp, MeasurementPackage::SensorType sensor, const ArrayXXd& z) {
+
+  for (int t = 0; t < n_tracks_; ++t) {
+
+    if (is_initialized_[t]) {
+      dt_(t) = (timestamp - time_us_[t]) / 1000000.0;
+      gain_mask_(t) = 1.0;
+      time_us_[t] = timestamp;
+      continue;
+    }
+
+    // same initial state and covariance as UKF::ProcessMeasurement; with
+    // dt = 0 and a zero gain the rest of this step leaves the track as is
+    x_.row(t).setZero();
+    P_.row(t).setZero();
+    if (sensor == MeasurementPackage::LASER) {
+      x_(t, 0) = z(t, 0);
+      x_(t, 1) = z(t, 1);
+      x_(t, 2) = 0.2;
+      P_(t, idx(0, 0, n_x)) = 0.01;
+      P_(t, idx(1, 1, n_x)) = 0.01;
+      P_(t, idx(2, 2, n_x)) = 1;
+      P_(t, idx(3, 3, n_x)) = 1;
+      P_(t, idx(4, 4, n_x)) = 1;
+    } else {
+      x_(t, 0) = z(t, 0) * cos(z(t, 1));
+      x_(t, 1) = z(t, 0) * sin(z(t, 1));
+      x_(t, 2) = z(t, 2);
+      x_(t, 3) = z(t, 1);
+      P_(t, idx(0, 0, n_x)) = 0.01;
+      P_(t, idx(1, 1, n_x)) = 0.01;
+      P_(t, idx(2, 2, n_x)) = 0.01;
+      P_(t, idx(3, 3, n_x)) = 0.09;
+      P_(t, idx(4, 4, n_x)) = 0.09;
+    }
+
+    is_initialized_[t] = true;
+    time_us_[t] = timestamp;
+    dt_(t) = 0;
+    gain_mask_(t) = 0;
+  }
+}
+
+void UKFBatch::Prediction(const ArrayXd& delta_t) {
+  for (int begin = 0; begin < n_tracks_; begin += kBlock) {
+    PredictBlock(begin, std::min(kBlock, n_tracks_ - begin), delta_t);
+  }
+}
+
+void UKFBatch::UpdateLidar(const ArrayXXd& z) {
+  for (int begin = 0; begin < n_tracks_; begin += kBlock) {
+    UpdateLidarBlock(begin, std::min(kBlock, n_tracks_ - begin), z);
+  }
+}
+
+void UKFBatch::UpdateRadar(const ArrayXXd& z) {
+  for (int begin = 0; begin < n_tracks_; begin += kBlock) {
+    UpdateRadarBlock(begin, std::min(kBlock, n_tracks_ - begin), z);
+  }
+}
+
+void UKFBatch::PredictBlock(int begin, int n, const ArrayXd& delta_t) {
+
+  Rows x = x_.middleRows(begin, n);
+  Rows P = P_.middleRows(begin, n);
+  Rows Xsig_pred = Xsig_pred_.middleRows(begin, n);
+  Rows L = L_.topRows(n);
+  Rows Xsig_aug = Xsig_aug_.topRows(n);
+  Rows Xdiff = Xdiff_.topRows(n);
+
+  /**
+  *  Generate sigma points for augmented states
+  */
+  // Cholesky factor of every P, one column at a time. The process noise
+  // block of the augmented covariance is diagonal and uncorrelated with the
+  // state, so only the state block needs factoring.
+  L.setZero();
+  for (int j = 0; j < n_x; ++j) {
+    L.col(idx(j, j, n_x)) = P.col(idx(j, j, n_x));
+    for (int k = 0; k < j; ++k) {
+      L.col(idx(j, j, n_x)) -= L.col(idx(j, k, n_x)).square();
+    }
+    L.col(idx(j, j, n_x)) = L.col(idx(j, j, n_x)).sqrt();
+
+    for (int i = j + 1; i < n_x; ++i) {
+      L.col(idx(i, j, n_x)) = P.col(idx(i, j, n_x));
+      for (int k = 0; k < j; ++k) {
+        L.col(idx(i, j, n_x)) -= L.col(idx(i, k, n_x)) * L.col(idx(j, k, n_x));
+      }
+      L.col(idx(i, j, n_x)) /= L.col(idx(j, j, n_x));
+    }
+  }
+
+  // create augmented sigma points
+  double sqrt_lambda_n_aug = sqrt(lambda_ + n_aug);
+  for (int k = 0; k < n_aug; ++k) {
+    for (int i = 0; i < n_sig; ++i) {
+      if (k < n_x) {
+        Xsig_aug.col(sig(k, i)) = x.col(k);
+      } else {
+        Xsig_aug.col(sig(k, i)).setZero();
+      }
+    }
+  }
+  for (int i = 0; i < n_x; ++i) {
+    for (int k = i; k < n_x; ++k) {
+      Xsig_aug.col(sig(k, i + 1)) += sqrt_lambda_n_aug * L.col(idx(k, i, n_x));
+      Xsig_aug.col(sig(k, i + 1 + n_aug)) -= sqrt_lambda_n_aug * L.col(idx(k, i, n_x));
+    }
+  }
+  Xsig_aug.col(sig(n_x, n_x + 1)).setConstant(sqrt_lambda_n_aug * std_a_);
+  Xsig_aug.col(sig(n_x, n_x + 1 + n_aug)).setConstant(-sqrt_lambda_n_aug * std_a_);
+  Xsig_aug.col(sig(n_x + 1, n_x + 2)).setConstant(sqrt_lambda_n_aug * std_yawdd_);
+  Xsig_aug.col(sig(n_x + 1, n_x + 2 + n_aug)).setConstant(-sqrt_lambda_n_aug * std_yawdd_);
+
+  /**
+  *  Apply motion model on generated sigma points
+  */
+  const double* aug[n_aug];
+  double* pred[n_x];
+  for (int i = 0; i < n_sig; ++i) {
+    for (int k = 0; k < n_aug; ++k) {
+      aug[k] = &Xsig_aug(0, sig(k, i));
+    }
+    for (int k = 0; k < n_x; ++k) {
+      pred[k] = &Xsig_pred(0, sig(k, i));
+    }
+    ctrv::PredictSigmaPointsSoA(aug, pred, delta_t.data() + begin, n);
+  }
+
+  /**
+  *  Get predicted mean and covariance
+  */
+  for (int k = 0; k < n_x; ++k) {
+    x.col(k) = weights_(0) * Xsig_pred.col(sig(k, 0));
+    for (int i = 1; i < n_sig; ++i) {
+      x.col(k) += weights_(i) * Xsig_pred.col(sig(k, i));
+    }
+  }
+
+  for (int k = 0; k < n_x; ++k) {
+    for (int i = 0; i < n_sig; ++i) {
+      Xdiff.col(sig(k, i)) = Xsig_pred.col(sig(k, i)) - x.col(k);
+    }
+  }
+  for (int i = 0; i < n_sig; ++i) {
+    Xdiff.col(sig(3, i)) = Xdiff.col(sig(3, i)).unaryExpr(NormalizeAngle());
+  }
+
+  // predicted state covariance matrix, lower triangle mirrored to the upper
+  for (int r = 0; r < n_x; ++r) {
+    for (int c = 0; c <= r; ++c) {
+      P.col(idx(r, c, n_x)) = weights_(0) * Xdiff.col(sig(r, 0)) * Xdiff.col(sig(c, 0));
+      for (int i = 1; i < n_sig; ++i) {
+        P.col(idx(r, c, n_x)) += weights_(i) * Xdiff.col(sig(r, i)) * Xdiff.col(sig(c, i));
+      }
+      if (c != r) {
+        P.col(idx(c, r, n_x)) = P.col(idx(r, c, n_x));
+      }
+    }
+  }
+}
+
+void UKFBatch::UpdateLidarBlock(int begin, int n, const ArrayXXd& z) {
+
+  Rows Xsig_pred = Xsig_pred_.middleRows(begin, n);
+  Rows Zsig = Zsig_.topRows(n);
+
+  // transform sigma points into measurement space
+  for (int i = 0; i < n_sig; ++i) {
+    Zsig.col(sig(0, i)) = Xsig_pred.col(sig(0, i));      // p_x
+    Zsig.col(sig(1, i)) = Xsig_pred.col(sig(1, i));      // p_y
+  }
+
+  Eigen::Vector3d noise_var(std_laspx_ * std_laspx_, std_laspy_ * std_laspy_, 0);
+  Update(begin, n, 2, -1, z, noise_var);
+}
+
+void UKFBatch::UpdateRadarBlock(int begin, int n, const ArrayXXd& z) {
+
+  // transform sigma points into measurement space [rho phi rho_dot]
+  const double* pred[4];
+  double* meas[3];
+  for (int i = 0; i < n_sig; ++i) {
+    for (int k = 0; k < 4; ++k) {
+      pred[k] = &Xsig_pred_(begin, sig(k, i));
+    }
+    for (int k = 0; k < 3; ++k) {
+      meas[k] = &Zsig_(0, sig(k, i));
+    }
+    ctrv::RadarSigmaPointsSoA(pred, meas, n);
+  }
+
+  Eigen::Vector3d noise_var(std_radr_ * std_radr_, std_radphi_ * std_radphi_, std_radrd_ * std_radrd_);
+  Update(begin, n, 3, 1, z, noise_var);
+}
+
+void UKFBatch::Update(int begin, int n, int n_z, int angle_index, const ArrayXXd& z,
+                      const Eigen::Vector3d& noise_var) {
+
+  Rows x = x_.middleRows(begin, n);
+  Rows P = P_.middleRows(begin, n);
+  Rows Xsig_pred = Xsig_pred_.middleRows(begin, n);
+  Rows Xdiff = Xdiff_.topRows(n);
+  Rows Zsig = Zsig_.topRows(n);
+  Rows Zdiff = Zdiff_.topRows(n);
+  Rows z_pred = z_pred_.topRows(n);
+  Rows S = S_.topRows(n);
+  Rows Sinv = Sinv_.topRows(n);
+  Rows Tc = Tc_.topRows(n);
+  Rows K = K_.topRows(n);
+  Rows z_res = z_res_.topRows(n);
+  Eigen::VectorBlock<ArrayXd> det = det_.head(n);
+  Eigen::VectorBlock<ArrayXd> gain_mask = gain_mask_.segment(begin, n);
+
+  // mean predicted measurement
+  for (int k = 0; k < n_z; ++k) {
+    z_pred.col(k) = weights_(0) * Zsig.col(sig(k, 0));
+    for (int i = 1; i < n_sig; ++i) {
+      z_pred.col(k) += weights_(i) * Zsig.col(sig(k, i));
+    }
+  }
+
+  // measurement and state residuals of every sigma point
+  for (int i = 0; i < n_sig; ++i) {
+    for (int k = 0; k < n_z; ++k) {
+      Zdiff.col(sig(k, i)) = Zsig.col(sig(k, i)) - z_pred.col(k);
+    }
+    if (angle_index >= 0) {
+      Zdiff.col(sig(angle_index, i)) = Zdiff.col(sig(angle_index, i)).unaryExpr(NormalizeAngle());
+    }
+    for (int k = 0; k < n_x; ++k) {
+      Xdiff.col(sig(k, i)) = Xsig_pred.col(sig(k, i)) - x.col(k);
+    }
+    Xdiff.col(sig(3, i)) = Xdiff.col(sig(3, i)).unaryExpr(NormalizeAngle());
+  }
+
+  // innovation covariance matrix S with measurement noise on the diagonal
+  for (int r = 0; r < n_z; ++r) {
+    for (int c = 0; c <= r; ++c) {
+      S.col(idx(r, c, n_z)) = weights_(0) * Zdiff.col(sig(r, 0)) * Zdiff.col(sig(c, 0));
+      for (int i = 1; i < n_sig; ++i) {
+        S.col(idx(r, c, n_z)) += weights_(i) * Zdiff.col(sig(r, i)) * Zdiff.col(sig(c, i));
+      }
+      if (c != r) {
+        S.col(idx(c, r, n_z)) = S.col(idx(r, c, n_z));
+      }
+    }
+    S.col(idx(r, r, n_z)) += noise_var(r);
+  }
+
+  // cross correlation matrix Tc
+  for (int r = 0; r < n_x; ++r) {
+    for (int c = 0; c < n_z; ++c) {
+      Tc.col(idx(r, c, n_z)) = weights_(0) * Xdiff.col(sig(r, 0)) * Zdiff.col(sig(c, 0));
+      for (int i = 1; i < n_sig; ++i) {
+        Tc.col(idx(r, c, n_z)) += weights_(i) * Xdiff.col(sig(r, i)) * Zdiff.col(sig(c, i));
+      }
+    }
+  }
+
+  // closed form inverse of the symmetric 2x2 or 3x3 S
+  if (n_z == 2) {
+    det = S.col(0) * S.col(3) - S.col(1) * S.col(2);
+    Sinv.col(0) = S.col(3) / det;
+    Sinv.col(1) = -S.col(1) / det;
+    Sinv.col(2) = Sinv.col(1);
+    Sinv.col(3) = S.col(0) / det;
+  } else {
+    Sinv.col(0) = S.col(4) * S.col(8) - S.col(5) * S.col(5);
+    Sinv.col(1) = S.col(2) * S.col(5) - S.col(1) * S.col(8);
+    Sinv.col(2) = S.col(1) * S.col(5) - S.col(2) * S.col(4);
+    Sinv.col(4) = S.col(0) * S.col(8) - S.col(2) * S.col(2);
+    Sinv.col(5) = S.col(1) * S.col(2) - S.col(0) * S.col(5);
+    Sinv.col(8) = S.col(0) * S.col(4) - S.col(1) * S.col(1);
+    det = S.col(0) * Sinv.col(0) + S.col(1) * Sinv.col(1) + S.col(2) * Sinv.col(2);
+    Sinv.col(0) /= det;
+    Sinv.col(1) /= det;
+    Sinv.col(2) /= det;
+    Sinv.col(4) /= det;
+    Sinv.col(5) /= det;
+    Sinv.col(8) /= det;
+    Sinv.col(3) = Sinv.col(1);
+    Sinv.col(6) = Sinv.col(2);
+    Sinv.col(7) = Sinv.col(5);
+  }
+
+  // Kalman gain K, zero for tracks initialized by this measurement
+  for (int r = 0; r < n_x; ++r) {
+    for (int c = 0; c < n_z; ++c) {
+      K.col(idx(r, c, n_z)) = Tc.col(idx(r, 0, n_z)) * Sinv.col(idx(0, c, n_z));
+      for (int j = 1; j < n_z; ++j) {
+        K.col(idx(r, c, n_z)) += Tc.col(idx(r, j, n_z)) * Sinv.col(idx(j, c, n_z));
+      }
+      K.col(idx(r, c, n_z)) *= gain_mask;
+    }
+  }
+
+  // residual
+  for (int k = 0; k < n_z; ++k) {
+    z_res.col(k) = z.col(k).segment(begin, n) - z_pred.col(k);
+  }
+  if (angle_index >= 0) {
+    z_res.col(angle_index) = z_res.col(angle_index).unaryExpr(NormalizeAngle());
+  }
+
+  // update state mean and covariance matrix, using K*S*K^T = K*Tc^T
+  for (int r = 0; r < n_x; ++r) {
+    for (int c = 0; c < n_z; ++c) {
+      x.col(r) += K.col(idx(r, c, n_z)) * z_res.col(c);
+    }
+    for (int s = 0; s < n_x; ++s) {
+      for (int c = 0; c < n_z; ++c) {
+        P.col(idx(r, s, n_x)) -= K.col(idx(r, c, n_z)) * Tc.col(idx(s, c, n_z));
+      }
+    }
+  }
+}
+
+UKF::StateVector UKFBatch::State(int track) const {
+  return x_.row(track).transpose().matrix();
+}
+
+UKF::StateMatrix UKFBatch::Covariance(int track) const {
+  UKF::StateMatrix P;
+  for (int r = 0; r < n_x; ++r) {
+    for (int c = 0; c < n_x; ++c) {
+      P(r, c) = P_(track, idx(r, c, n_x));
+    }
+  }
+  return P;
+}
@@ -0,0 +1,150 @@
+#ifndef UKF_BATCH_H
+#define UKF_BATCH_H
+
+#include <vector>
+#include "Eigen/Dense"
+#include "ukf.h"
+
+/**
+ * CTRV unscented Kalman filter for many tracks at once.
+ *
+ * Every buffer is laid out structure-of-arrays: row t of each array belongs
+ * to track t, and each column holds one scalar (a state component, a
+ * covariance entry or a sigma point component) for all tracks contiguously.
+ * Tracks are filtered in blocks of a few dozen so the scratch arrays of a
+ * block stay in cache across the column-wise passes, and the process and
+ * radar models run through the structure-of-arrays ctrv kernels.
+ */
+class UKFBatch {
+ public:
+  /**
+   * Constructor
+   * @param n_tracks Number of tracks handled by the batch
+   */
+  UKFBatch(int n_tracks);
+
+  /**
+   * Destructor
+   */
+  virtual ~UKFBatch();
+
+  /**
+   * Initializes, predicts and updates all tracks with lidar measurements
+   * taken at the same timestamp
+   * @param timestamp Measurement time in us
+   * @param z Measurements, one row [p_x p_y] per track
+   */
+  void ProcessLidar(long long timestamp, const Eigen::ArrayXXd& z);
+
+  /**
+   * Initializes, predicts and updates all tracks with radar measurements
+   * taken at the same timestamp
+   * @param timestamp Measurement time in us
+   * @param z Measurements, one row [rho phi rho_dot] per track
+   */
+  void ProcessRadar(long long timestamp, const Eigen::ArrayXXd& z);
+
+  /**
+   * Predicts sigma points, states and covariances of all tracks
+   * @param delta_t Time between k and k+1 in s, one entry per track
+   */
+  void Prediction(const Eigen::ArrayXd& delta_t);
+
+  /**
+   * Updates all active tracks using laser measurements
+   * @param z Measurements at k+1, one row [p_x p_y] per track
+   */
+  void UpdateLidar(const Eigen::ArrayXXd& z);
+
+  /**
+   * Updates all active tracks using radar measurements
+   * @param z Measurements at k+1, one row [rho phi rho_dot] per track
+   */
+  void UpdateRadar(const Eigen::ArrayXXd& z);
+
+  // state vector of a single track
+  UKF::StateVector State(int track) const;
+
+  // state covariance matrix of a single track
+  UKF::StateMatrix Covariance(int track) const;
+
+  // number of tracks
+  int n_tracks_;
+
+  // initially set to false, set to true in first measurement of the track
+  std::vector<bool> is_initialized_;
+
+  // time when the state of each track is true, in us
+  std::vector<long long> time_us_;
+
+  // states, column k is state component k of every track
+  Eigen::ArrayXXd x_;
+
+  // covariances, column r * n_x + c is P(r, c) of every track
+  Eigen::ArrayXXd P_;
+
+  // predicted sigma points, column k * n_sig + i is component k of sigma point i
+  Eigen::ArrayXXd Xsig_pred_;
+
+  // Process noise standard deviation longitudinal acceleration in m/s^2
+  double std_a_;
+
+  // Process noise standard deviation yaw acceleration in rad/s^2
+  double std_yawdd_;
+
+  // Laser measurement noise standard deviation position1 in m
+  double std_laspx_;
+
+  // Laser measurement noise standard deviation position2 in m
+  double std_laspy_;
+
+  // Radar measurement noise standard deviation radius in m
+  double std_radr_;
+
+  // Radar measurement noise standard deviation angle in rad
+  double std_radphi_;
+
+  // Radar measurement noise standard deviation radius change in m/s
+  double std_radrd_;
+
+  // Weights of sigma points
+  UKF::WeightVector weights_;
+
+  // Sigma point spreading parameter
+  double lambda_;
+
+ private:
+  // starts uninitialized tracks from a measurement and sets up dt_ and gain_mask_
+  void Prepare(long long timestamp, MeasurementPackage::SensorType sensor, const Eigen::ArrayXXd& z);
+
+  // prediction and updates of tracks [begin, begin + n), n at most one block
+  void PredictBlock(int begin, int n, const Eigen::ArrayXd& delta_t);
+  void UpdateLidarBlock(int begin, int n, const Eigen::ArrayXXd& z);
+  void UpdateRadarBlock(int begin, int n, const Eigen::ArrayXXd& z);
+
+  // shared update once Zsig_ holds the n_z measurement sigma points of the block
+  void Update(int begin, int n, int n_z, int angle_index, const Eigen::ArrayXXd& z,
+              const Eigen::Vector3d& noise_var);
+
+  // per-track elapsed time of the current step in s
+  Eigen::ArrayXd dt_;
+
+  // 1 for tracks that take the current update, 0 for tracks just initialized
+  Eigen::ArrayXd gain_mask_;
+
+  // scratch buffers for one block of tracks, sized once in the constructor
+  Eigen::ArrayXXd L_;
+  Eigen::ArrayXXd Xsig_aug_;
+  Eigen::ArrayXXd Xdiff_;
+  Eigen::ArrayXXd Zsig_;
+  Eigen::ArrayXXd Zdiff_;
+  Eigen::ArrayXXd z_pred_;
+  Eigen::ArrayXXd S_;
+  Eigen::ArrayXXd Sinv_;
+  Eigen::ArrayXd det_;
+  Eigen::ArrayXXd Tc_;
+  Eigen::ArrayXXd K_;
+  Eigen::ArrayXXd z_res_;
+};
+
+#endif  // UKF_BATCH_H
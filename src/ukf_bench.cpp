@@ -0,0 +1,864 @@
+// Microbenchmarks of the filter, the batched filter, the IMM bank, data association, the RMSE,
+// lidar ray casting and PCD loading
+//
+// usage: ukf_bench [--filter substring] [--samples N] [--json file] [--pcd directory] [--verify]
+//
+// Every benchmark runs on fixed inputs, so two runs on the same machine
+// measure the same work. A benchmark is timed in samples of a calibrated
+// number of operations; the report gives the mean ns/op, the p50/p90/p99 of
+// the per-sample ns/op and the heap allocations per op, counted at the malloc
+// level so Eigen's dynamic matrices are included.
+//
+// --verify runs no benchmarks; it checks that the vectorized code paths
+// agree with their scalar references, UKFBatch with one UKF per track, the
+// closed-form lidar update with the sigma point one and the square-root UKF
+// with the standard one, and exits with 1 if any does not.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <string>
+#include <vector>
+#include "counter_rng.h"
+#include "ctrv_kernel.h"
+#include "imm.h"
+#include "sensor_sim.h"
+#include "sensors/frame_store.h"
+#include "sensors/pcd_container.h"
+#include "sensors/scene.h"
+#include "track_manager.h"
+#include "ukf.h"
+#include "ukf_batch.h"
+#ifdef UKF_BENCH_PCL
+#include "sensors/lidar.h"
+#include "tools.h"
+#endif
+
+// every heap allocation of the process, to report allocations per op
+static std::atomic<long long> allocations(0);
+
+#if defined(__GLIBC__)
+
+// Counted at the malloc level, so Eigen's aligned_malloc, C code and
+// allocations inside libraries show up as well as operator new. The
+// definitions below interpose glibc's and forward to its internal entry
+// points, which does not recurse the way a dlsym lookup would.
+extern "C" {
+
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* p, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+void __libc_free(void* p);
+
+void* malloc(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_realloc(p, size);
+}
+
+void* memalign(std::size_t alignment, std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** p, std::size_t alignment, std::size_t size)
+{
+	if(alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+		return EINVAL;
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	*p = __libc_memalign(alignment, size);
+	return *p ? 0 : ENOMEM;
+}
+
+void free(void* p)
+{
+	__libc_free(p);
+}
+
+}  // extern "C"
+
+#else
+
+// no portable malloc interposition elsewhere, count operator new only
+void* operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if(void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+#endif
+
+namespace {
+
+// results are folded in here so the compiler cannot drop the work
+volatile double sink;
+
+struct BenchResult
+{
+	std::string name;
+	long long opsPerSample;
+	int samples;
+	double nsPerOp;
+	double p50, p90, p99;
+	double allocsPerOp;
+};
+
+class BenchRunner
+{
+public:
+	std::string filter;
+	int samples = 30;
+	std::vector<BenchResult> results;
+
+	// times op(i) for i = 0, 1, ... in samples; calibrating the sample size
+	// also warms up caches and branch predictors
+	void run(const std::string& name, const std::function<void(long long)>& op)
+	{
+		if(!filter.empty() && name.find(filter) == std::string::npos)
+			return;
+
+		// grow the sample until it takes at least a millisecond
+		long long ops = 1;
+		while(time(op, ops) < 1e6 && ops < (1LL << 30))
+			ops *= 2;
+
+		std::vector<double> perOp;
+		perOp.reserve(samples);
+		double totalNs = 0;
+		long long allocs = allocations.load();
+		for(int s = 0; s < samples; s++)
+		{
+			double ns = time(op, ops);
+			perOp.push_back(ns / ops);
+			totalNs += ns;
+		}
+		allocs = allocations.load() - allocs;
+		std::sort(perOp.begin(), perOp.end());
+
+		BenchResult result;
+		result.name = name;
+		result.opsPerSample = ops;
+		result.samples = samples;
+		result.nsPerOp = totalNs / ((double)ops * samples);
+		result.p50 = percentile(perOp, 0.50);
+		result.p90 = percentile(perOp, 0.90);
+		result.p99 = percentile(perOp, 0.99);
+		result.allocsPerOp = (double)allocs / ((double)ops * samples);
+		results.push_back(result);
+
+		std::printf("%-32s %12.1f ns/op  p50 %12.1f  p90 %12.1f  p99 %12.1f  %8.2f allocs/op\n",
+			name.c_str(), result.nsPerOp, result.p50, result.p90, result.p99, result.allocsPerOp);
+		std::fflush(stdout);
+	}
+
+	bool writeJson(const std::string& file) const
+	{
+		std::ofstream out(file);
+		out << "{\"benchmarks\":[";
+		for(size_t i = 0; i < results.size(); i++)
+		{
+			const BenchResult& r = results[i];
+			out << (i ? ",\n" : "\n") << "{\"name\":\"" << r.name << "\",\"ops_per_sample\":" << r.opsPerSample
+				<< ",\"samples\":" << r.samples << ",\"ns_per_op\":" << r.nsPerOp << ",\"p50_ns\":" << r.p50
+				<< ",\"p90_ns\":" << r.p90 << ",\"p99_ns\":" << r.p99 << ",\"allocs_per_op\":" << r.allocsPerOp << "}";
+		}
+		out << "\n]}\n";
+		return !out.fail();
+	}
+
+private:
+	static double time(const std::function<void(long long)>& op, long long ops)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for(long long i = 0; i < ops; i++)
+			op(i);
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// nearest rank
+	static double percentile(const std::vector<double>& sorted, double p)
+	{
+		size_t rank = (size_t)std::ceil(p * sorted.size());
+		return sorted[std::max<size_t>(rank, 1) - 1];
+	}
+};
+
+MeasurementPackage lidarMeasurement(double px, double py, long long timestamp)
+{
+	MeasurementPackage meas;
+	meas.sensor_type_ = MeasurementPackage::LASER;
+	meas.raw_measurements_ = VectorXd(2);
+	meas.raw_measurements_ << px, py;
+	meas.timestamp_ = timestamp;
+	return meas;
+}
+
+MeasurementPackage radarMeasurement(double rho, double phi, double rho_dot, long long timestamp)
+{
+	MeasurementPackage meas;
+	meas.sensor_type_ = MeasurementPackage::RADAR;
+	meas.raw_measurements_ = VectorXd(3);
+	meas.raw_measurements_ << rho, phi, rho_dot;
+	meas.timestamp_ = timestamp;
+	return meas;
+}
+
+// a filter that has tracked a car for a second, as in the highway scenario
+UKF trackedFilter(bool useSqrt)
+{
+	UKF ukf;
+	ukf.use_sqrt_ = useSqrt;
+	for(int k = 0; k < 30; k++)
+	{
+		long long t = k * 33333LL;
+		double px = -10 + 5 * t / 1e6;
+		ukf.ProcessMeasurement(lidarMeasurement(px, 4, t));
+		ukf.ProcessMeasurement(radarMeasurement(std::sqrt(px * px + 16), std::atan2(4, px), 5 * px / std::sqrt(px * px + 16), t));
+	}
+	return ukf;
+}
+
+// unlabeled lidar detections of targets in five lanes 6 m apart, moving at
+// 5 m/s, at frame k
+void associationFrame(int frame, std::vector<MeasurementPackage>& detections)
+{
+	CounterRng rng(3);
+	long long t = frame * 33333LL;
+	for(size_t i = 0; i < detections.size(); i++)
+	{
+		VectorXd& z = detections[i].raw_measurements_;
+		z(0) = 6.0 * (i / 5) + 5 * t / 1e6 + 0.15 * rng.gaussian(2 * (frame * detections.size() + i));
+		z(1) = 4.0 * (i % 5 - 2.0) + 0.15 * rng.gaussian(2 * (frame * detections.size() + i) + 1);
+		detections[i].timestamp_ = t;
+	}
+}
+
+// the same car tracked by the IMM bank
+IMMFilter trackedImm()
+{
+	IMMFilter imm;
+	for(int k = 0; k < 30; k++)
+	{
+		long long t = k * 33333LL;
+		double px = -10 + 5 * t / 1e6;
+		imm.ProcessMeasurement(lidarMeasurement(px, 4, t));
+		imm.ProcessMeasurement(radarMeasurement(std::sqrt(px * px + 16), std::atan2(4, px), 5 * px / std::sqrt(px * px + 16), t));
+	}
+	return imm;
+}
+
+// frame k of many tracks in three lanes, each at its own speed: one row of
+// [p_x p_y] and [rho phi rho_dot] per track
+void trackFrame(int frame, Eigen::ArrayXXd& lidar, Eigen::ArrayXXd& radar)
+{
+	double t = frame * 33333LL / 1e6;
+	for(int i = 0; i < lidar.rows(); i++)
+	{
+		double speed = 4 + i % 5;
+		double px = -10 - 6.0 * (i / 15) + speed * t;
+		double py = 4.0 * (i % 3 - 1) + 2;
+		double rho = std::sqrt(px * px + py * py);
+		lidar(i, 0) = px + 0.1 * std::sin(7.0 * frame + i);
+		lidar(i, 1) = py + 0.1 * std::cos(5.0 * frame + i);
+		radar(i, 0) = rho;
+		radar(i, 1) = std::atan2(py, px);
+		radar(i, 2) = speed * px / rho;
+	}
+}
+
+// frame k of trackFrame's tracks, lidar then radar at the same timestamp,
+// through one UKF per track
+void feedFilters(int frame, const Eigen::ArrayXXd& lidar, const Eigen::ArrayXXd& radar, std::vector<UKF>& filters,
+	MeasurementPackage& lidarMeas, MeasurementPackage& radarMeas)
+{
+	lidarMeas.timestamp_ = radarMeas.timestamp_ = frame * 33333LL;
+	for(size_t i = 0; i < filters.size(); i++)
+	{
+		lidarMeas.raw_measurements_ << lidar(i, 0), lidar(i, 1);
+		filters[i].ProcessMeasurement(lidarMeas);
+		radarMeas.raw_measurements_ << radar(i, 0), radar(i, 1), radar(i, 2);
+		filters[i].ProcessMeasurement(radarMeas);
+	}
+}
+
+// the same frame through UKFBatch
+void feedBatch(int frame, const Eigen::ArrayXXd& lidar, const Eigen::ArrayXXd& radar, UKFBatch& batch)
+{
+	batch.ProcessLidar(frame * 33333LL, lidar);
+	batch.ProcessRadar(frame * 33333LL, radar);
+}
+
+// largest |a - b| / (1 + |b|) over n values
+double maxRelativeError(const double* a, const double* b, int n)
+{
+	double worst = 0;
+	for(int i = 0; i < n; i++)
+		worst = std::max(worst, std::fabs(a[i] - b[i]) / (1 + std::fabs(b[i])));
+	return worst;
+}
+
+bool reportCheck(const std::string& name, double error, double tolerance)
+{
+	bool ok = error <= tolerance;
+	std::printf("%-40s max error %10.3g  tolerance %8.1g  %s\n", name.c_str(), error, tolerance, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+// a random sigma point component; yaw rates are drawn around the 0.001
+// switch between the turning and the straight line formulas as well
+double randomComponent(const CounterRng& rng, uint64_t n, int row, int yawdRow)
+{
+	double u = rng.uniform(2 * n);
+	if(row != yawdRow)
+		return 20 * (u - 0.5);
+	double sign = rng.uniform(2 * n + 1) < 0.5 ? -1 : 1;
+	if(u < 0.25)
+		return sign * 0.001 * (1 + 1e-3 * (rng.uniform(3 * n) - 0.5));
+	if(u < 0.4)
+		return sign * 0.001;
+	if(u < 0.5)
+		return sign * 1e-6 * rng.uniform(3 * n);
+	return 4 * (u - 0.5);
+}
+
+// every vectorized sigma point kernel against its scalar reference, over
+// random blocks whose sizes leave partial vectors and partial blocks
+bool verifyKernels()
+{
+	struct Variant
+	{
+		std::string name;
+		ctrv::PredictSigmaPointsFn predict;
+		ctrv::PredictMaskedSigmaPointsFn masked;
+		ctrv::RadarSigmaPointsFn radar;
+		ctrv::PredictSigmaPointsSoAFn predictSoA;
+		ctrv::RadarSigmaPointsSoAFn radarSoA;
+	};
+	std::vector<Variant> variants;
+#if defined(__SSE2__)
+	variants.push_back(Variant{"sse2", ctrv::PredictSigmaPointsSSE2, ctrv::PredictMaskedSigmaPointsSSE2, ctrv::RadarSigmaPointsSSE2,
+			ctrv::PredictSigmaPointsSoASSE2, ctrv::RadarSigmaPointsSoASSE2});
+#endif
+#if defined(UKF_ENABLE_AVX2)
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		variants.push_back(Variant{"avx2", ctrv::PredictSigmaPointsAVX2, ctrv::PredictMaskedSigmaPointsAVX2, ctrv::RadarSigmaPointsAVX2,
+			ctrv::PredictSigmaPointsSoAAVX2, ctrv::RadarSigmaPointsSoAAVX2});
+#endif
+	if(variants.empty())
+	{
+		std::printf("no vectorized kernels on this CPU, nothing to verify\n");
+		return true;
+	}
+
+	const int trials = 200;
+	const int maxSig = 53;
+	const double dts[] = {0.001, 0.033, 0.1, 1.0};
+	CounterRng rng(7);
+	bool ok = true;
+	for(const Variant& variant : variants)
+	{
+		double predictError = 0, maskedError = 0, radarError = 0, soaError = 0, radarSoAError = 0;
+		for(int t = 0; t < trials; t++)
+		{
+			int n_sig = 1 + t % maxSig;
+			double dt = dts[t % 4];
+			uint64_t n = (uint64_t)t * maxSig * 8;
+
+			// CTRV, [p_x p_y v yaw yawd nu_a nu_yawdd] per column
+			std::vector<double> aug(7 * n_sig), expected(5 * n_sig), actual(5 * n_sig);
+			for(int i = 0; i < 7 * n_sig; i++)
+				aug[i] = randomComponent(rng, n + i, i % 7, 4);
+			ctrv::PredictSigmaPointsScalar(aug.data(), 7, expected.data(), 5, n_sig, dt);
+			variant.predict(aug.data(), 7, actual.data(), 5, n_sig, dt);
+			predictError = std::max(predictError, maxRelativeError(actual.data(), expected.data(), 5 * n_sig));
+
+			// masked CTRA, [p_x p_y v yaw yawd a nu_long nu_yawdd] per column
+			std::vector<double> maskedAug(8 * n_sig), turn(n_sig), accel(n_sig);
+			std::vector<double> maskedExpected(6 * n_sig), maskedActual(6 * n_sig);
+			for(int i = 0; i < 8 * n_sig; i++)
+				maskedAug[i] = randomComponent(rng, n + 7 * n_sig + i, i % 8, 4);
+			for(int i = 0; i < n_sig; i++)
+			{
+				turn[i] = (t + i) % 3 != 0;
+				accel[i] = (t + i) % 3 == 2;
+			}
+			ctrv::PredictMaskedSigmaPointsScalar(maskedAug.data(), 8, maskedExpected.data(), 6, turn.data(), accel.data(), n_sig, dt);
+			variant.masked(maskedAug.data(), 8, maskedActual.data(), 6, turn.data(), accel.data(), n_sig, dt);
+			maskedError = std::max(maskedError, maxRelativeError(maskedActual.data(), maskedExpected.data(), 6 * n_sig));
+
+			// radar transform of the predicted CTRA points
+			std::vector<double> zExpected(3 * n_sig), zActual(3 * n_sig);
+			ctrv::RadarSigmaPointsScalar(maskedExpected.data(), 6, zExpected.data(), 3, n_sig);
+			variant.radar(maskedExpected.data(), 6, zActual.data(), 3, n_sig);
+			radarError = std::max(radarError, maxRelativeError(zActual.data(), zExpected.data(), 3 * n_sig));
+
+			// structure-of-arrays CTRV with a time step per point, then its
+			// radar transform, on the same points as the first check
+			std::vector<double> soaAug(7 * n_sig), soaPred(5 * n_sig), soaZ(3 * n_sig), stepDt(n_sig);
+			const double* augRows[7];
+			double* predRows[5];
+			double* zRows[3];
+			for(int k = 0; k < 7; k++)
+				augRows[k] = soaAug.data() + k * n_sig;
+			for(int k = 0; k < 5; k++)
+				predRows[k] = soaPred.data() + k * n_sig;
+			for(int k = 0; k < 3; k++)
+				zRows[k] = soaZ.data() + k * n_sig;
+			for(int i = 0; i < n_sig; i++)
+			{
+				stepDt[i] = dts[(t + i) % 4];
+				for(int k = 0; k < 7; k++)
+					soaAug[k * n_sig + i] = aug[i * 7 + k];
+				ctrv::PredictSigmaPointsScalar(&aug[i * 7], 7, &expected[i * 5], 5, 1, stepDt[i]);
+				ctrv::RadarSigmaPointsScalar(&expected[i * 5], 5, &zExpected[i * 3], 3, 1);
+			}
+			variant.predictSoA(augRows, predRows, stepDt.data(), n_sig);
+			variant.radarSoA(predRows, zRows, n_sig);
+			for(int i = 0; i < n_sig; i++)
+			{
+				for(int k = 0; k < 5; k++)
+					actual[i * 5 + k] = soaPred[k * n_sig + i];
+				for(int k = 0; k < 3; k++)
+					zActual[i * 3 + k] = soaZ[k * n_sig + i];
+			}
+			soaError = std::max(soaError, maxRelativeError(actual.data(), expected.data(), 5 * n_sig));
+			radarSoAError = std::max(radarSoAError, maxRelativeError(zActual.data(), zExpected.data(), 3 * n_sig));
+		}
+		// the turning formulas divide by the yaw rate, so the kernels' few
+		// ulp of sin and cos grow near the 0.001 switch; more so for CTRA,
+		// which divides by its square
+		ok = reportCheck("kernel/predict/" + variant.name, predictError, 1e-10) && ok;
+		ok = reportCheck("kernel/predict_masked/" + variant.name, maskedError, 1e-8) && ok;
+		ok = reportCheck("kernel/radar/" + variant.name, radarError, 1e-12) && ok;
+		ok = reportCheck("kernel/predict_soa/" + variant.name, soaError, 1e-10) && ok;
+		ok = reportCheck("kernel/radar_soa/" + variant.name, radarSoAError, 1e-10) && ok;
+	}
+	return ok;
+}
+
+// UKFBatch against one UKF per track on the same measurements, state and
+// covariance of every track after every frame
+bool verifyBatch()
+{
+	const int tracks = 45;
+	UKFBatch batch(tracks);
+	std::vector<UKF> filters(tracks);
+	Eigen::ArrayXXd lidar(tracks, 2), radar(tracks, 3);
+	MeasurementPackage lidarMeas = lidarMeasurement(0, 0, 0), radarMeas = radarMeasurement(0, 0, 0, 0);
+	double stateError = 0, covarianceError = 0;
+	for(int frame = 0; frame < 60; frame++)
+	{
+		trackFrame(frame, lidar, radar);
+		feedBatch(frame, lidar, radar, batch);
+		feedFilters(frame, lidar, radar, filters, lidarMeas, radarMeas);
+		for(int i = 0; i < tracks; i++)
+		{
+			UKF::StateVector x = batch.State(i);
+			UKF::StateMatrix P = batch.Covariance(i);
+			stateError = std::max(stateError, maxRelativeError(x.data(), filters[i].x_.data(), x.size()));
+			covarianceError = std::max(covarianceError, maxRelativeError(P.data(), filters[i].P_.data(), P.size()));
+		}
+	}
+	bool ok = reportCheck("batch/state", stateError, 1e-9);
+	return reportCheck("batch/covariance", covarianceError, 1e-9) && ok;
+}
+
+// the closed-form lidar update against the sigma point update it replaces,
+// state and covariance of every track after every lidar/radar frame
+bool verifyLidarUpdate()
+{
+	const int tracks = 45;
+	std::vector<UKF> fast(tracks), reference(tracks);
+	Eigen::ArrayXXd lidar(tracks, 2), radar(tracks, 3);
+	MeasurementPackage lidarMeas = lidarMeasurement(0, 0, 0), radarMeas = radarMeasurement(0, 0, 0, 0);
+	double stateError = 0, covarianceError = 0;
+	for(int frame = 0; frame < 60; frame++)
+	{
+		trackFrame(frame, lidar, radar);
+		feedFilters(frame, lidar, radar, fast, lidarMeas, radarMeas);
+		for(int i = 0; i < tracks; i++)
+		{
+			// ProcessMeasurement, with the lidar update taken through the
+			// sigma points
+			UKF& ukf = reference[i];
+			lidarMeas.raw_measurements_ << lidar(i, 0), lidar(i, 1);
+			if(!ukf.is_initialized_)
+				ukf.ProcessMeasurement(lidarMeas);
+			else
+			{
+				ukf.Prediction((lidarMeas.timestamp_ - ukf.time_us_) / 1000000.0);
+				ukf.UnscentedUpdate(LidarSigmaPointModel(ukf.std_laspx_, ukf.std_laspy_), lidarMeas);
+				ukf.time_us_ = lidarMeas.timestamp_;
+			}
+			radarMeas.raw_measurements_ << radar(i, 0), radar(i, 1), radar(i, 2);
+			ukf.ProcessMeasurement(radarMeas);
+
+			stateError = std::max(stateError, maxRelativeError(fast[i].x_.data(), ukf.x_.data(), ukf.x_.size()));
+			covarianceError = std::max(covarianceError, maxRelativeError(fast[i].P_.data(), ukf.P_.data(), ukf.P_.size()));
+		}
+	}
+	bool ok = reportCheck("lidar_update/state", stateError, 1e-9);
+	return reportCheck("lidar_update/covariance", covarianceError, 1e-9) && ok;
+}
+
+// the square-root UKF against the standard one on the same measurements,
+// state and covariance of every track after every frame
+bool verifySqrt()
+{
+	const int tracks = 45;
+	std::vector<UKF> standard(tracks), squareRoot(tracks);
+	for(UKF& ukf : squareRoot)
+		ukf.use_sqrt_ = true;
+	Eigen::ArrayXXd lidar(tracks, 2), radar(tracks, 3);
+	MeasurementPackage lidarMeas = lidarMeasurement(0, 0, 0), radarMeas = radarMeasurement(0, 0, 0, 0);
+	double stateError = 0, covarianceError = 0;
+	for(int frame = 0; frame < 60; frame++)
+	{
+		trackFrame(frame, lidar, radar);
+		feedFilters(frame, lidar, radar, standard, lidarMeas, radarMeas);
+		feedFilters(frame, lidar, radar, squareRoot, lidarMeas, radarMeas);
+		for(int i = 0; i < tracks; i++)
+		{
+			stateError = std::max(stateError, maxRelativeError(squareRoot[i].x_.data(), standard[i].x_.data(), standard[i].x_.size()));
+			covarianceError = std::max(covarianceError, maxRelativeError(squareRoot[i].P_.data(), standard[i].P_.data(), standard[i].P_.size()));
+		}
+	}
+	bool ok = reportCheck("sqrt/state", stateError, 1e-9);
+	return reportCheck("sqrt/covariance", covarianceError, 1e-9) && ok;
+}
+
+// cars spread over the three lanes of the highway
+std::vector<Car> traffic(int count)
+{
+	std::vector<Car> cars;
+	CounterRng rng(1);
+	for(int i = 0; i < count; i++)
+	{
+		double x = -15 + 65 * rng.uniform(2 * i);
+		double y = 4.0 * (i % 3 - 1);
+		cars.push_back(Car(Vect3(x, y, 0), Vect3(4, 2, 2), Color(0, 0, 1), 5, 0.4 * (rng.uniform(2 * i + 1) - 0.5), 2, "car" + std::to_string(i)));
+	}
+	return cars;
+}
+
+// the ray directions of Lidar, 64 layers over a full turn
+std::vector<Vect3> lidarRays()
+{
+	const double pi = 3.1415;
+	std::vector<Vect3> rays;
+	double steepestAngle = 24.8*(-pi/180);
+	double angleRange = 26.8*(pi/180);
+	double angleIncrement = angleRange/64;
+	for(double v = steepestAngle; v < steepestAngle+angleRange; v += angleIncrement)
+		for(double h = 0; h <= 2*pi; h += pi/2250)
+			rays.push_back(Vect3(cos(v)*cos(h), cos(v)*sin(h), sin(v)));
+	return rays;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	BenchRunner bench;
+	std::string jsonFile;
+	std::string pcdDirectory = "../src/sensors/data/pcd";
+	bool verify = false;
+	for(int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if(i + 1 < argc && arg == "--filter")
+			bench.filter = argv[++i];
+		else if(i + 1 < argc && arg == "--samples")
+			bench.samples = std::max(1, std::atoi(argv[++i]));
+		else if(i + 1 < argc && arg == "--json")
+			jsonFile = argv[++i];
+		else if(i + 1 < argc && arg == "--pcd")
+			pcdDirectory = argv[++i];
+		else if(arg == "--verify")
+			verify = true;
+		else
+		{
+			std::cerr << "usage: " << argv[0] << " [--filter substring] [--samples N] [--json file] [--pcd directory] [--verify]" << std::endl;
+			return 2;
+		}
+	}
+
+	if(verify)
+	{
+		bool ok = verifyKernels();
+		ok = verifyBatch() && ok;
+		ok = verifyLidarUpdate() && ok;
+		ok = verifySqrt() && ok;
+		return ok ? 0 : 1;
+	}
+
+	// known to allocate once per op through Eigen's aligned_malloc, a check
+	// that the allocation counter sees the filters' allocations
+	bench.run("alloc/eigen_dynamic_matrix", [&](long long i) {
+		Eigen::MatrixXd m = Eigen::MatrixXd::Constant(5, 5, (double)i);
+		sink = m.sum();
+	});
+
+	// UKF, then the square-root UKF; each op starts from the same tracked
+	// filter
+	MeasurementPackage frameLidar = lidarMeasurement(5.2, 4.1, 30 * 33333LL);
+	MeasurementPackage frameRadar = radarMeasurement(6.6, 0.66, 3.1, 30 * 33333LL);
+	for(bool useSqrt : {false, true})
+	{
+		const std::string suffix = useSqrt ? "/sqrt" : "";
+		const UKF tracked = trackedFilter(useSqrt);
+		for(double dt : {0.001, 0.033, 0.1, 1.0})
+		{
+			char name[64];
+			std::snprintf(name, sizeof(name), "ukf/predict/dt=%g%s", dt, suffix.c_str());
+			UKF ukf = tracked;
+			bench.run(name, [&](long long) {
+				ukf = tracked;
+				ukf.Prediction(dt);
+				sink = ukf.x_[0];
+			});
+		}
+		UKF predicted = tracked;
+		predicted.Prediction(0.033);
+		UKF ukf = predicted;
+		MeasurementPackage lidar = lidarMeasurement(5.2, 4.1, 0);
+		MeasurementPackage radar = radarMeasurement(6.6, 0.66, 3.1, 0);
+		bench.run("ukf/update_lidar" + suffix, [&](long long) {
+			ukf = predicted;
+			ukf.UpdateLidar(lidar);
+			sink = ukf.x_[0];
+		});
+		bench.run("ukf/update_radar" + suffix, [&](long long) {
+			ukf = predicted;
+			ukf.UpdateRadar(radar);
+			sink = ukf.x_[0];
+		});
+		// a simulator frame: lidar, then radar at the same timestamp
+		bench.run("ukf/frame" + suffix, [&](long long) {
+			ukf = tracked;
+			ukf.ProcessMeasurement(frameLidar);
+			ukf.ProcessMeasurement(frameRadar);
+			sink = ukf.x_[0];
+		});
+	}
+
+	// the CV/CTRV/CTRA bank on the same car, against the UKF above
+	const IMMFilter trackedBank = trackedImm();
+	{
+		IMMFilter imm = trackedBank;
+		bench.run("imm/predict/dt=0.033", [&](long long) {
+			imm = trackedBank;
+			imm.Prediction(0.033);
+			sink = imm.x_[0];
+		});
+		IMMFilter predicted = trackedBank;
+		predicted.Prediction(0.033);
+		MeasurementPackage lidar = lidarMeasurement(5.2, 4.1, 0);
+		MeasurementPackage radar = radarMeasurement(6.6, 0.66, 3.1, 0);
+		bench.run("imm/update_lidar", [&](long long) {
+			imm = predicted;
+			imm.UpdateLidar(lidar);
+			sink = imm.x_[0];
+		});
+		bench.run("imm/update_radar", [&](long long) {
+			imm = predicted;
+			imm.UpdateRadar(radar);
+			sink = imm.x_[0];
+		});
+		bench.run("imm/frame", [&](long long) {
+			imm = trackedBank;
+			imm.ProcessMeasurement(frameLidar);
+			imm.ProcessMeasurement(frameRadar);
+			sink = imm.x_[0];
+		});
+	}
+
+	// many tracks per frame, UKFBatch against a UKF per track; the filters
+	// carry on from frame to frame, each op is the next frame
+	for(int tracks : {100, 1000, 10000})
+	{
+		Eigen::ArrayXXd lidar(tracks, 2), radar(tracks, 3);
+		MeasurementPackage lidarMeas = lidarMeasurement(0, 0, 0), radarMeas = radarMeasurement(0, 0, 0, 0);
+		std::vector<UKF> filters(tracks);
+		bench.run("ukf/frame/tracks=" + std::to_string(tracks), [&](long long i) {
+			trackFrame(i, lidar, radar);
+			feedFilters(i, lidar, radar, filters, lidarMeas, radarMeas);
+			sink = filters[0].x_[0];
+		});
+		UKFBatch batch(tracks);
+		bench.run("batch/frame/tracks=" + std::to_string(tracks), [&](long long i) {
+			trackFrame(i, lidar, radar);
+			feedBatch(i, lidar, radar, batch);
+			sink = batch.x_(0, 0);
+		});
+	}
+
+	// one frame of lidar detections against confirmed tracks of every
+	// target, the cost per target should not grow with the target count
+	for(int targets : {10, 100, 500, 2000})
+	{
+		std::vector<MeasurementPackage> detections(targets, lidarMeasurement(0, 0, 0));
+		TrackManager tracker;
+		int frame = 0;
+		for(; frame < 10; frame++)
+		{
+			associationFrame(frame, detections);
+			tracker.update(detections);
+		}
+		bench.run("association/lidar_update/targets=" + std::to_string(targets), [&](long long) {
+			associationFrame(frame++, detections);
+			tracker.update(detections);
+			sink = tracker.tracks().size();
+		});
+	}
+
+	// RMSE over a growing history, against the running accumulator
+	SensorSim sensors;
+	for(int history : {100, 1000, 10000})
+	{
+		std::vector<VectorXd> estimations, truth;
+		CounterRng rng(2);
+		for(int i = 0; i < history; i++)
+		{
+			VectorXd e(4), g(4);
+			for(int k = 0; k < 4; k++)
+			{
+				g(k) = rng.gaussian(8 * i + k);
+				e(k) = g(k) + 0.1 * rng.gaussian(8 * i + 4 + k);
+			}
+			estimations.push_back(e);
+			truth.push_back(g);
+		}
+		bench.run("rmse/calculate/history=" + std::to_string(history), [&](long long) {
+			sink = sensors.CalculateRMSE(estimations, truth)[0];
+		});
+	}
+	{
+		RmseAccumulator accuracy;
+		Eigen::Vector4d truth(1, 2, 3, 4), estimate(1.1, 2.1, 2.9, 4.2);
+		bench.run("rmse/accumulator_add", [&](long long i) {
+			accuracy.add(i % 3, estimate, truth);
+			sink = accuracy.count();
+		});
+	}
+
+	// lidar rays against the scene grid, the work of one scan on one thread
+	const std::vector<Vect3> rays = lidarRays();
+	const Vect3 origin(0, 0, 3.0);
+	for(int cars : {1, 3, 10, 30, 200})
+	{
+		LidarScene scene;
+		for(const Car& car : traffic(cars))
+			scene.addCar(car);
+		scene.addHighwayPoles(0);
+		scene.build();
+		bench.run("lidar/cast_rays/cars=" + std::to_string(cars), [&](long long) {
+			double total = 0;
+			for(const Vect3& d : rays)
+			{
+				double ground = d.z < 0 ? -origin.z / d.z : std::numeric_limits<double>::infinity();
+				double hit = std::min(ground, scene.intersect(origin, d, std::min(ground, 120.0)));
+				if(hit < 120)
+					total += hit;
+			}
+			sink = total;
+		});
+	}
+#ifdef UKF_BENCH_PCL
+	for(int cars : {1, 3, 10, 30, 200})
+	{
+		Lidar lidar(traffic(cars), 0);
+		bench.run("lidar/scan/cars=" + std::to_string(cars), [&](long long) {
+			sink = lidar.scan()->points.size();
+		});
+	}
+#endif
+
+	// recorded frames, one file per frame against the packed container
+	std::vector<std::pair<long long, std::string> > files;
+	if(listPcdFrames(pcdDirectory, files) && !files.empty())
+	{
+		std::vector<float> xyz;
+		bench.run("pcd/read_file", [&](long long i) {
+			readPcdXyz(files[i % files.size()].second, xyz);
+			sink = xyz.size();
+		});
+#ifdef UKF_BENCH_PCL
+		Tools tools;
+		bench.run("pcd/tools_load", [&](long long i) {
+			sink = tools.loadPcd(files[i % files.size()].second)->points.size();
+		});
+#endif
+		std::string container = "ukf_bench.ukfpcd";
+		PcdContainerWriter writer;
+		bool packed = writer.open(container, false);
+		for(size_t f = 0; packed && f < files.size(); f++)
+			packed = readPcdXyz(files[f].second, xyz) && writer.addFrame(files[f].first, xyz.data(), xyz.size() / 3);
+		packed = writer.close() && packed;
+		PcdFrameStore store;
+		if(packed && store.open(container))
+		{
+			bench.run("pcd/container_view", [&](long long i) {
+				PcdFrameView view;
+				store.view(i % store.size(), view, xyz);
+				double total = 0;
+				for(size_t p = 0; p < view.points; p++)
+					total += view.xyz[3 * p];
+				sink = total;
+			});
+			store.close();
+		}
+		std::remove(container.c_str());
+	}
+	else
+		std::cerr << "no PCD frames in " << pcdDirectory << ", skipping the pcd benchmarks" << std::endl;
+
+	if(!jsonFile.empty() && !bench.writeJson(jsonFile))
+	{
+		std::cerr << "Failed to write " << jsonFile << std::endl;
+		return 1;
+	}
+	return 0;
+}